@@ -0,0 +1,195 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+// Qt includes
+
+#include <QTest>
+#include <QThread>
+#include <QUrl>
+
+// Local includes
+
+#include "filereadwritelockregistry.h"
+#include "interface.h"
+
+using namespace KIPI;
+
+namespace
+{
+
+QUrl testUrl(int index)
+{
+    return QUrl::fromLocalFile(QString::fromLatin1("/album/image%1.jpg").arg(index));
+}
+
+/** Return the result of @p test run in another thread.
+ */
+template <typename Test>
+bool inOtherThread(Test test)
+{
+    bool result          = false;
+    QThread* const thread = QThread::create([&result, test]() { result = test(); });
+    thread->start();
+    thread->wait();
+    delete thread;
+
+    return result;
+}
+
+} // namespace
+
+class FileReadWriteLockRegistryTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void testSharedLock();
+    void testCount();
+    void testDeleteLocked();
+    void testOutliveRegistry();
+    void testConcurrentCreate();
+};
+
+void FileReadWriteLockRegistryTest::testSharedLock()
+{
+    FileReadWriteLockRegistry registry;
+    std::unique_ptr<FileReadWriteLock> first(registry.createReadWriteLock(testUrl(1)));
+    std::unique_ptr<FileReadWriteLock> same(registry.createReadWriteLock(QUrl::fromLocalFile(QString::fromLatin1("/album/./image1.jpg"))));
+    std::unique_ptr<FileReadWriteLock> other(registry.createReadWriteLock(testUrl(2)));
+
+    first->lockForWrite();
+
+    QVERIFY(!inOtherThread([&same]() { return same->tryLockForRead(); }));
+    QVERIFY(inOtherThread([&other]() { const bool locked = other->tryLockForWrite(); other->unlock(); return locked; }));
+
+    // The lock is recursive.
+
+    first->lockForWrite();
+    first->unlock();
+    first->unlock();
+
+    QVERIFY(inOtherThread([&same]() { const bool locked = same->tryLockForWrite(); same->unlock(); return locked; }));
+}
+
+void FileReadWriteLockRegistryTest::testCount()
+{
+    FileReadWriteLockRegistry registry;
+
+    QCOMPARE(registry.count(), 0);
+
+    std::unique_ptr<FileReadWriteLock> first(registry.createReadWriteLock(testUrl(1)));
+    std::unique_ptr<FileReadWriteLock> same(registry.createReadWriteLock(testUrl(1)));
+
+    QCOMPARE(registry.count(), 1);
+
+    std::unique_ptr<FileReadWriteLock> other(registry.createReadWriteLock(testUrl(2)));
+
+    QCOMPARE(registry.count(), 2);
+
+    // The file is forgotten with its last lock only.
+
+    first.reset();
+
+    QCOMPARE(registry.count(), 2);
+
+    same.reset();
+    other.reset();
+
+    QCOMPARE(registry.count(), 0);
+}
+
+void FileReadWriteLockRegistryTest::testDeleteLocked()
+{
+    FileReadWriteLockRegistry registry;
+    FileReadWriteLock* const locked = registry.createReadWriteLock(testUrl(1));
+    std::unique_ptr<FileReadWriteLock> other(registry.createReadWriteLock(testUrl(1)));
+
+    locked->lockForRead();
+    locked->lockForRead();
+
+    QVERIFY(!inOtherThread([&other]() { return other->tryLockForWrite(); }));
+
+    // Deleting the lock unlocks it as often as it was locked.
+
+    delete locked;
+
+    QVERIFY(inOtherThread([&other]() { const bool done = other->tryLockForWrite(); other->unlock(); return done; }));
+}
+
+void FileReadWriteLockRegistryTest::testOutliveRegistry()
+{
+    std::unique_ptr<FileReadWriteLock> first;
+    std::unique_ptr<FileReadWriteLock> same;
+
+    {
+        FileReadWriteLockRegistry registry;
+        first.reset(registry.createReadWriteLock(testUrl(1)));
+        same.reset(registry.createReadWriteLock(testUrl(1)));
+    }
+
+    first->lockForWrite();
+
+    QVERIFY(!inOtherThread([&same]() { return same->tryLockForRead(); }));
+
+    first->unlock();
+    first.reset();
+    same.reset();
+}
+
+void FileReadWriteLockRegistryTest::testConcurrentCreate()
+{
+    const int threads = 8;
+    const int files   = 10;
+
+    FileReadWriteLockRegistry registry;
+    QList<QThread*> workers;
+    QAtomicInt      failures;
+
+    for (int i = 0 ; i < threads ; ++i)
+    {
+        workers << QThread::create([&registry, &failures, i]()
+            {
+                for (int j = 0 ; j < 1000 ; ++j)
+                {
+                    std::unique_ptr<FileReadWriteLock> lock(registry.createReadWriteLock(testUrl((i + j) % files)));
+
+                    if (j % 2)
+                    {
+                        lock->lockForRead();
+                    }
+                    else
+                    {
+                        lock->lockForWrite();
+                    }
+
+                    if (registry.count() < 1 || registry.count() > files)
+                    {
+                        failures.ref();
+                    }
+
+                    lock->unlock();
+                }
+            }
+        );
+
+        workers.last()->start();
+    }
+
+    for (QThread* const worker : std::as_const(workers))
+    {
+        QVERIFY(worker->wait());
+    }
+
+    qDeleteAll(workers);
+
+    QCOMPARE(failures.loadRelaxed(), 0);
+    QCOMPARE(registry.count(), 0);
+}
+
+QTEST_GUILESS_MAIN(FileReadWriteLockRegistryTest)
+
+#include "filereadwritelockregistrytest.moc"
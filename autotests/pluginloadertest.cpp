@@ -0,0 +1,91 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+// Qt includes
+
+#include <QTest>
+#include <QSignalSpy>
+#include <QStandardPaths>
+
+// KF includes
+
+#include <KXmlGuiWindow>
+#include <KXMLGUIFactory>
+
+// Local includes
+
+#include "plugin.h"
+#include "pluginloader.h"
+#include "testinterface.h"
+
+using namespace KIPI;
+
+class PluginLoaderTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void initTestCase();
+    void testPlugAllMakesChangesOnce();
+};
+
+void PluginLoaderTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void PluginLoaderTest::testPlugAllMakesChangesOnce()
+{
+    KXmlGuiWindow window;
+    TestInterface iface(&window);
+    PluginLoader loader(&window);
+    loader.setInterface(&iface);
+    loader.init();
+
+    int plugins = 0;
+
+    for (PluginLoader::Info* const info : loader.pluginList())
+    {
+        Plugin* const plugin = info->plugin();
+
+        if (plugin)
+        {
+            plugin->setup(&window);
+            ++plugins;
+        }
+    }
+
+    if (plugins < 2)
+    {
+        QSKIP("At least two kipi plugins must be installed to compare the gui builds");
+    }
+
+    KXMLGUIFactory* const factory = window.guiFactory();
+    QSignalSpy changes(factory, &KXMLGUIFactory::makingChanges);
+    QSignalSpy clients(factory, &KXMLGUIFactory::clientAdded);
+
+    QCOMPARE(loader.plugAll(factory), plugins);
+
+    // One client per plugin, plus the client holding them, but one batch of changes only.
+
+    QCOMPARE(clients.count(), plugins + 1);
+    QCOMPARE(changes.count(), 2);
+    QCOMPARE(changes.at(0).at(0).toBool(), true);
+    QCOMPARE(changes.at(1).at(0).toBool(), false);
+    QVERIFY(window.updatesEnabled());
+
+    // Plugging again replaces the previous clients.
+
+    clients.clear();
+
+    QCOMPARE(loader.plugAll(factory), plugins);
+    QCOMPARE(clients.count(), plugins + 1);
+}
+
+QTEST_MAIN(PluginLoaderTest)
+
+#include "pluginloadertest.moc"
@@ -0,0 +1,185 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+// Qt includes
+
+#include <QTest>
+#include <QSignalSpy>
+#include <QThread>
+
+// Local includes
+
+#include "progressitem.h"
+#include "testinterface.h"
+
+using namespace KIPI;
+
+/** Host interface recording the calls made to its progress manager.
+ */
+class ProgressInterface : public TestInterface
+{
+public:
+
+    QString progressScheduled(const QString&, bool, bool) const override
+    {
+        return QString::fromLatin1("progress");
+    }
+
+    void progressValueChanged(const QString&, float percent) override
+    {
+        ++values;
+        lastPercent = percent;
+    }
+
+    void progressStatusChanged(const QString&, const QString& status) override
+    {
+        ++statuses;
+        lastStatus = status;
+    }
+
+    void progressCompleted(const QString&) override
+    {
+        ++completions;
+    }
+
+public:
+
+    int     values      = 0;
+    int     statuses    = 0;
+    int     completions = 0;
+    float   lastPercent = -1.0F;
+    QString lastStatus;
+};
+
+// -----------------------------------------------------------------------------------------------------------
+
+class ProgressItemTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void testChildFraction();
+    void testConcurrentAdvance();
+    void testCoalescedUpdates();
+    void testCancel();
+};
+
+void ProgressItemTest::testChildFraction()
+{
+    ProgressInterface iface;
+    ProgressItem item(&iface, QString::fromLatin1("task"));
+    item.setTotal(4);
+    item.advance();
+
+    ProgressItem* const child = item.createChild(10, 2);
+    child->advance(5);
+
+    QCOMPARE(item.fraction(), 0.5);
+    QVERIFY(child->id().isNull());
+
+    child->complete();
+
+    QCOMPARE(item.fraction(), 0.75);
+    QVERIFY(!item.isCompleted());
+
+    item.complete();
+
+    QCOMPARE(item.fraction(), 1.0);
+}
+
+void ProgressItemTest::testConcurrentAdvance()
+{
+    const int threads = 4;
+    const int steps   = 10000;
+
+    ProgressInterface iface;
+    ProgressItem item(&iface, QString::fromLatin1("task"));
+    item.setTotal(threads * steps);
+
+    QList<QThread*> workers;
+
+    for (int i = 0; i < threads; ++i)
+    {
+        workers << QThread::create([&item]()
+            {
+                for (int j = 0; j < steps; ++j)
+                {
+                    item.advance();
+                }
+            }
+        );
+
+        workers.last()->start();
+    }
+
+    for (QThread* const worker : std::as_const(workers))
+    {
+        QVERIFY(worker->wait());
+    }
+
+    qDeleteAll(workers);
+
+    QCOMPARE(item.completed(), qint64(threads * steps));
+    QCOMPARE(item.fraction(), 1.0);
+}
+
+void ProgressItemTest::testCoalescedUpdates()
+{
+    ProgressInterface iface;
+
+    {
+        ProgressItem item(&iface, QString::fromLatin1("task"));
+        item.setUpdateInterval(10);
+        item.setTotal(1000);
+
+        // Changes made between two samplings are forwarded to the host as one call.
+
+        for (int i = 0; i < 1000; ++i)
+        {
+            item.advance();
+            item.setStatus(QString::number(i));
+        }
+
+        QTRY_COMPARE(iface.lastPercent, 100.0F);
+        QCOMPARE(iface.values, 1);
+        QCOMPARE(iface.statuses, 1);
+        QCOMPARE(iface.lastStatus, QString::fromLatin1("999"));
+
+        item.complete();
+
+        QTRY_COMPARE(iface.completions, 1);
+    }
+
+    // The entry is completed only once, even when the item is deleted after.
+
+    QCOMPARE(iface.completions, 1);
+}
+
+void ProgressItemTest::testCancel()
+{
+    ProgressInterface iface;
+    ProgressItem item(&iface, QString::fromLatin1("task"), true);
+    ProgressItem* const child = item.createChild(1);
+
+    QSignalSpy spy(&item, &ProgressItem::canceled);
+
+    Q_EMIT iface.progressCanceled(QString::fromLatin1("other"));
+
+    QCOMPARE(spy.count(), 0);
+    QVERIFY(!child->isCanceled());
+
+    Q_EMIT iface.progressCanceled(item.id());
+    Q_EMIT iface.progressCanceled(item.id());
+
+    QCOMPARE(spy.count(), 1);
+    QVERIFY(item.isCanceled());
+    QVERIFY(child->isCanceled());
+}
+
+QTEST_GUILESS_MAIN(ProgressItemTest)
+
+#include "progressitemtest.moc"
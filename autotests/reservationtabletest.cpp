@@ -0,0 +1,260 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+// Qt includes
+
+#include <QTest>
+#include <QSignalSpy>
+#include <QThread>
+#include <QUrl>
+
+// Local includes
+
+#include "reservationtable.h"
+
+using namespace KIPI;
+
+namespace
+{
+
+QList<QUrl> testUrls(int count)
+{
+    QList<QUrl> urls;
+
+    for (int i = 0 ; i < count ; ++i)
+    {
+        urls << QUrl::fromLocalFile(QString::fromLatin1("/album/image%1.jpg").arg(i));
+    }
+
+    return urls;
+}
+
+} // namespace
+
+class ReservationTableTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void initTestCase();
+    void testSingleItemSignals();
+    void testBatchSignals();
+    void testOtherHolder();
+    void testReleaseOnDelete();
+    void testConcurrentReserve();
+};
+
+void ReservationTableTest::initTestCase()
+{
+    qRegisterMetaType<QList<QUrl> >();
+}
+
+void ReservationTableTest::testSingleItemSignals()
+{
+    ReservationTable table;
+    QObject holder;
+    const QUrl url = QUrl::fromLocalFile(QString::fromLatin1("/album/image.jpg"));
+
+    QSignalSpy reserved(&table, &ReservationTable::reserved);
+    QSignalSpy released(&table, &ReservationTable::released);
+    QSignalSpy itemReserved(&table, &ReservationTable::itemReserved);
+    QSignalSpy itemReleased(&table, &ReservationTable::itemReleased);
+
+    QVERIFY(table.reserve(url, &holder, QString::fromLatin1("rotate")));
+
+    QCOMPARE(itemReserved.count(), 1);
+    QCOMPARE(itemReserved.at(0).at(0).toUrl(), url);
+    QCOMPARE(reserved.count(), 0);
+
+    // Items are compared without redundant path segments.
+
+    QString description;
+    QVERIFY(table.isReserved(QUrl::fromLocalFile(QString::fromLatin1("/album/./image.jpg")), &description));
+    QCOMPARE(description, QString::fromLatin1("rotate"));
+
+    table.release(url, &holder);
+
+    QCOMPARE(itemReleased.count(), 1);
+    QCOMPARE(released.count(), 0);
+    QCOMPARE(table.count(), 0);
+
+    // Releasing an item which is not reserved emits nothing.
+
+    table.release(url, &holder);
+
+    QCOMPARE(itemReleased.count(), 1);
+}
+
+void ReservationTableTest::testBatchSignals()
+{
+    ReservationTable table;
+    QObject holder;
+    const QList<QUrl> urls = testUrls(100);
+
+    QSignalSpy reserved(&table, &ReservationTable::reserved);
+    QSignalSpy released(&table, &ReservationTable::released);
+    QSignalSpy itemReserved(&table, &ReservationTable::itemReserved);
+    QSignalSpy itemReleased(&table, &ReservationTable::itemReleased);
+
+    QCOMPARE(table.reserve(urls, &holder, QString::fromLatin1("export")), urls);
+
+    QCOMPARE(reserved.count(), 1);
+    QCOMPARE(reserved.at(0).at(0).value<QList<QUrl> >(), urls);
+    QCOMPARE(itemReserved.count(), 0);
+    QCOMPARE(table.count(), urls.size());
+
+    QCOMPARE(table.release(urls.mid(0, 10), &holder), urls.mid(0, 10));
+
+    QCOMPARE(released.count(), 1);
+    QCOMPARE(itemReleased.count(), 0);
+    QCOMPARE(table.reservedItems(urls), urls.mid(10));
+}
+
+void ReservationTableTest::testOtherHolder()
+{
+    ReservationTable table;
+    QObject first;
+    const QList<QUrl> urls = testUrls(10);
+
+    QCOMPARE(table.reserve(urls.mid(0, 5), &first, QString::fromLatin1("first")).size(), 5);
+
+    QSignalSpy reserved(&table, &ReservationTable::reserved);
+    QSignalSpy released(&table, &ReservationTable::released);
+
+    {
+        QObject second;
+
+        // Items reserved by another object are skipped.
+
+        QCOMPARE(table.reserve(urls, &second, QString::fromLatin1("second")), urls.mid(5));
+        QVERIFY(!table.reserve(urls.at(0), &second, QString::fromLatin1("second")));
+        QVERIFY(table.release(urls.mid(0, 5), &second).isEmpty());
+    }
+
+    QCOMPARE(reserved.count(), 1);
+
+    // The items of the second object are released once, when it is deleted.
+
+    QCOMPARE(released.count(), 1);
+    QCOMPARE(released.at(0).at(0).value<QList<QUrl> >().size(), 5);
+    QCOMPARE(table.reservedItems(urls), urls.mid(0, 5));
+
+    {
+        QObject third;
+
+        // An object which reserved nothing is not watched, and releases nothing when deleted.
+
+        QVERIFY(table.reserve(urls.mid(0, 5), &third, QString::fromLatin1("third")).isEmpty());
+    }
+
+    QCOMPARE(released.count(), 1);
+    QCOMPARE(table.count(), 5);
+}
+
+void ReservationTableTest::testReleaseOnDelete()
+{
+    ReservationTable table;
+    QObject* const holder = new QObject;
+    const QList<QUrl> urls = testUrls(20);
+
+    table.reserve(urls, holder, QString::fromLatin1("export"));
+
+    QSignalSpy released(&table, &ReservationTable::released);
+
+    delete holder;
+
+    QCOMPARE(released.count(), 1);
+    QCOMPARE(released.at(0).at(0).value<QList<QUrl> >().size(), urls.size());
+    QCOMPARE(table.count(), 0);
+}
+
+void ReservationTableTest::testConcurrentReserve()
+{
+    const int threads      = 8;
+    const QList<QUrl> urls = testUrls(1000);
+
+    ReservationTable      table;
+    QList<QObject*>       holders;
+    QVector<QList<QUrl> > results(threads);
+    QVector<QList<QUrl> > releases(threads);
+    QList<QThread*>       workers;
+
+    for (int i = 0 ; i < threads ; ++i)
+    {
+        holders << new QObject;
+    }
+
+    // All threads reserve the same items: each item must be reserved by exactly one of them.
+
+    for (int i = 0 ; i < threads ; ++i)
+    {
+        QList<QUrl>* const result = &results[i];
+
+        workers << QThread::create([&table, &urls, &holders, result, i]()
+            {
+                for (const QUrl& url : urls)
+                {
+                    if (table.reserve(url, holders.at(i), QString::number(i)))
+                    {
+                        result->append(url);
+                    }
+                }
+            }
+        );
+
+        workers.last()->start();
+    }
+
+    for (QThread* const worker : std::as_const(workers))
+    {
+        QVERIFY(worker->wait());
+    }
+
+    qDeleteAll(workers);
+    workers.clear();
+
+    int total = 0;
+
+    for (int i = 0 ; i < threads ; ++i)
+    {
+        total += results.at(i).size();
+    }
+
+    QCOMPARE(total, urls.size());
+    QCOMPARE(table.count(), urls.size());
+
+    // Each thread releases its items in one batch.
+
+    for (int i = 0 ; i < threads ; ++i)
+    {
+        QList<QUrl>* const release = &releases[i];
+
+        workers << QThread::create([&table, &holders, &results, release, i]()
+            {
+                *release = table.release(results.at(i), holders.at(i));
+            }
+        );
+
+        workers.last()->start();
+    }
+
+    for (QThread* const worker : std::as_const(workers))
+    {
+        QVERIFY(worker->wait());
+    }
+
+    qDeleteAll(workers);
+
+    QCOMPARE(releases, results);
+    QCOMPARE(table.count(), 0);
+
+    qDeleteAll(holders);
+}
+
+QTEST_GUILESS_MAIN(ReservationTableTest)
+
+#include "reservationtabletest.moc"
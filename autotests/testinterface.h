@@ -0,0 +1,58 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KIPI_TESTINTERFACE_H
+#define KIPI_TESTINTERFACE_H
+
+// Local includes
+
+#include "interface.h"
+#include "imagecollection.h"
+#include "imageinfo.h"
+
+namespace KIPI
+{
+
+/** Host interface with no album, supporting all features, used by the tests.
+ */
+class TestInterface : public Interface
+{
+public:
+
+    explicit TestInterface(QObject* const parent = nullptr)
+        : Interface(parent, QString::fromLatin1("TestInterface"))
+    {
+    }
+
+    ImageCollection currentAlbum() override
+    {
+        return ImageCollection();
+    }
+
+    ImageCollection currentSelection() override
+    {
+        return ImageCollection();
+    }
+
+    QList<ImageCollection> allAlbums() override
+    {
+        return QList<ImageCollection>();
+    }
+
+    ImageInfo info(const QUrl&) override
+    {
+        return ImageInfo(nullptr);
+    }
+
+    int features() const override
+    {
+        return ~0;
+    }
+};
+
+} // namespace KIPI
+
+#endif /* KIPI_TESTINTERFACE_H */
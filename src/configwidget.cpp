@@ -7,10 +7,21 @@
 
 #include "configwidget.h"
 
+// Std includes
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
 // Qt include
 
 #include <QList>
 #include <QHeaderView>
+#include <QAbstractTableModel>
+#include <QSortFilterProxyModel>
+#include <QIcon>
+#include <QHash>
+#include <QVector>
 
 // KF includes
 
@@ -20,51 +31,398 @@
 namespace KIPI
 {
 
-class PluginCheckBox : public QTreeWidgetItem
+/** A row of the plugins list. Each property is read from the plugin info when it is first used,
+ *  so that sorting the list by name does not load the icons of all plugins.
+ */
+class PluginRow
 {
 public:
 
-    PluginCheckBox(PluginLoader::Info* const info, QTreeWidget* const parent)
-        : QTreeWidgetItem(parent),
-          m_info(info)
+    explicit PluginRow(PluginLoader::Info* const info)
+        : m_info(info),
+          m_state(info->shouldLoad() ? Qt::Checked : Qt::Unchecked),
+          m_resolved{false, false, false, false},
+          m_iconResolved(false)
     {
-        setFlags(Qt::ItemIsUserCheckable | Qt::ItemIsEnabled);
-        setChildIndicatorPolicy(QTreeWidgetItem::DontShowIndicator);
-        setDisabled(false);
+    };
+
+    QString text(int column) const
+    {
+        if (m_resolved[column])
+            return m_text[column];
+
+        switch (column)
+        {
+            case 0:
+            {
+                // Name
+                m_text[0] = m_info->name();
+                break;
+            }
 
-        // Name + Icon + Selector
-        setText(0, m_info->name());
-        setIcon(0, m_info->icon());
-        setCheckState(0, m_info->shouldLoad() ? Qt::Checked : Qt::Unchecked);
+            case 1:
+            {
+                // Categories
+                QStringList list = m_info->pluginCategories();
+                list.removeDuplicates();
+                list.sort();
+                m_text[1] = list.join(QString::fromLatin1(", "));
+                break;
+            }
 
-        // Categories
-        QStringList list = m_info->pluginCategories();
-        list.removeDuplicates();
-        list.sort();
-        setText(1, list.join(QString::fromLatin1(", ")));
+            case 2:
+            {
+                // Description
+                m_text[2] = m_info->comment();
+                break;
+            }
 
-        // Description
-        setText(2, m_info->comment());
+            default:
+            {
+                // Author
+                m_text[3] = m_info->author().section(QString::fromLatin1(","), 0, 0);
+                break;
+            }
+        }
+
+        m_resolved[column] = true;
+
+        return m_text[column];
+    };
+
+    /** Return the key used to sort the rows by @p column. The name is read from the metadata
+     *  cache, without keeping a copy in the row.
+     */
+    QString sortKey(int column) const
+    {
+        return (column == 0 ? m_info->name() : text(column));
+    };
+
+    QIcon icon() const
+    {
+        // The icon comes from the desktop file, the plugin is never loaded to get it.
+
+        if (!m_iconResolved)
+        {
+            m_icon         = m_info->icon();
+            m_iconResolved = true;
+        }
 
-        // Author
-        setText(3, m_info->author().section(QString::fromLatin1(","), 0, 0));
+        return m_icon;
     };
 
-    ~PluginCheckBox() override
+    QString toolTip() const
     {
+        return (text(2) + QLatin1Char('\n') + m_info->author());
     };
 
-    bool contains(const QString& txt, Qt::CaseSensitivity cs) const
+    /** Return the searchable text of the row: name, categories, description and author.
+     *  Fields are separated by a new line, which is never part of a query.
+     */
+    QString searchText() const
     {
-        return (text(0).contains(txt, cs) ||
-                text(1).contains(txt, cs) ||
-                text(2).contains(txt, cs) ||
-                text(3).contains(txt, cs));
+        return (text(0) + QLatin1Char('\n') + text(1) + QLatin1Char('\n') +
+                text(2) + QLatin1Char('\n') + text(3));
     };
 
 public:
 
     PluginLoader::Info* m_info;
+    Qt::CheckState      m_state;
+
+private:
+
+    mutable bool        m_resolved[4];
+    mutable QString     m_text[4];
+    mutable bool        m_iconResolved;
+    mutable QIcon       m_icon;
+};
+
+// ---------------------------------------------------------------------
+
+class PluginListModel : public QAbstractTableModel
+{
+public:
+
+    /// Role used by the proxy to sort rows.
+    static const int SortRole = Qt::UserRole;
+
+public:
+
+    explicit PluginListModel(QObject* const parent)
+        : QAbstractTableModel(parent)
+    {
+    };
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override
+    {
+        return (parent.isValid() ? 0 : m_rows.count());
+    };
+
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override
+    {
+        return (parent.isValid() ? 0 : 4);
+    };
+
+    QVariant data(const QModelIndex& index, int role) const override
+    {
+        if (!index.isValid())
+            return QVariant();
+
+        const PluginRow& row = m_rows.at(index.row());
+
+        switch (role)
+        {
+            case Qt::DisplayRole:
+                return row.text(index.column());
+
+            case SortRole:
+                return row.sortKey(index.column());
+
+            case Qt::DecorationRole:
+                return (index.column() == 0 ? QVariant(row.icon()) : QVariant());
+
+            case Qt::ToolTipRole:
+                return row.toolTip();
+
+            case Qt::CheckStateRole:
+                return (index.column() == 0 ? QVariant(row.m_state) : QVariant());
+
+            default:
+                return QVariant();
+        }
+    };
+
+    bool setData(const QModelIndex& index, const QVariant& value, int role) override
+    {
+        if (!index.isValid() || index.column() != 0 || role != Qt::CheckStateRole)
+            return false;
+
+        setCheckState(index.row(), static_cast<Qt::CheckState>(value.toInt()));
+
+        return true;
+    };
+
+    Qt::ItemFlags flags(const QModelIndex& index) const override
+    {
+        if (!index.isValid())
+            return Qt::NoItemFlags;
+
+        Qt::ItemFlags flags = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+
+        if (index.column() == 0)
+            flags |= Qt::ItemIsUserCheckable;
+
+        return flags;
+    };
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override
+    {
+        if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section < m_labels.count())
+            return m_labels.at(section);
+
+        return QAbstractTableModel::headerData(section, orientation, role);
+    };
+
+    void setHeaderLabels(const QStringList& labels)
+    {
+        m_labels = labels;
+        Q_EMIT headerDataChanged(Qt::Horizontal, 0, columnCount() - 1);
+    };
+
+    void setCheckState(int row, Qt::CheckState state)
+    {
+        if (m_rows.at(row).m_state == state)
+            return;
+
+        m_rows[row].m_state = state;
+        Q_EMIT dataChanged(index(row, 0), index(row, 0), QVector<int>() << Qt::CheckStateRole);
+    };
+
+public:
+
+    QList<PluginRow> m_rows;
+
+private:
+
+    QStringList      m_labels;
+};
+
+// ---------------------------------------------------------------------
+
+/** Trigram index over the case-folded searchable text of the rows. It is built on first search,
+ *  so that opening the list does not read the properties of all plugins.
+ *
+ *  The rows holding all trigrams of a query are the candidates, which are then checked with a
+ *  plain substring search. A query which refines the previous one only checks the previous results.
+ */
+class PluginSearchIndex
+{
+public:
+
+    explicit PluginSearchIndex(const QList<PluginRow>& rows)
+        : m_rows(rows),
+          m_built(false),
+          m_lastCs(Qt::CaseSensitive)
+    {
+    };
+
+    /** Return the sorted list of rows matching @p query.
+     */
+    QVector<int> search(const QString& query, Qt::CaseSensitivity cs)
+    {
+        build();
+
+        const QString folded = query.toCaseFolded();
+        QVector<int>  candidates;
+        bool          all    = true;
+
+        // Refined query: results are a subset of the previous ones.
+
+        if (!m_lastQuery.isEmpty() && cs == m_lastCs &&
+            (cs == Qt::CaseSensitive ? query.contains(m_lastQuery) : folded.contains(m_lastQuery)))
+        {
+            candidates = m_lastResults;
+            all        = false;
+        }
+
+        for (int i = 0; i + 3 <= folded.size(); ++i)
+        {
+            const QVector<int> postings = m_trigrams.value(trigram(folded, i));
+
+            if (all)
+            {
+                candidates = postings;
+                all        = false;
+            }
+            else
+            {
+                QVector<int> common;
+                std::set_intersection(candidates.constBegin(), candidates.constEnd(),
+                                      postings.constBegin(),   postings.constEnd(),
+                                      std::back_inserter(common));
+                candidates = common;
+            }
+
+            if (candidates.isEmpty())
+                break;
+        }
+
+        if (all)
+        {
+            candidates.resize(m_folded.size());
+            std::iota(candidates.begin(), candidates.end(), 0);
+        }
+
+        QVector<int> results;
+        results.reserve(candidates.size());
+
+        for (int row : std::as_const(candidates))
+        {
+            if (cs == Qt::CaseSensitive ? m_texts.at(row).contains(query) : m_folded.at(row).contains(folded))
+                results.append(row);
+        }
+
+        m_lastQuery   = (cs == Qt::CaseSensitive ? query : folded);
+        m_lastCs      = cs;
+        m_lastResults = results;
+
+        return results;
+    };
+
+private:
+
+    static quint64 trigram(const QString& text, int pos)
+    {
+        return ((quint64(text.at(pos).unicode())     << 32) |
+                (quint64(text.at(pos + 1).unicode()) << 16) |
+                 quint64(text.at(pos + 2).unicode()));
+    };
+
+    void build()
+    {
+        if (m_built)
+            return;
+
+        m_texts.reserve(m_rows.size());
+        m_folded.reserve(m_rows.size());
+
+        for (int row = 0; row < m_rows.size(); ++row)
+        {
+            m_texts.append(m_rows.at(row).searchText());
+            m_folded.append(m_texts.last().toCaseFolded());
+
+            const QString& folded = m_folded.last();
+
+            for (int i = 0; i + 3 <= folded.size(); ++i)
+            {
+                QVector<int>& postings = m_trigrams[trigram(folded, i)];
+
+                // Rows are indexed in order, so postings are sorted and a row is only added once.
+                if (postings.isEmpty() || postings.last() != row)
+                    postings.append(row);
+            }
+        }
+
+        m_built = true;
+    };
+
+private:
+
+    const QList<PluginRow>&      m_rows;
+    bool                         m_built;
+    QStringList                  m_texts;
+    QStringList                  m_folded;
+    QHash<quint64, QVector<int>> m_trigrams;
+
+    QString                      m_lastQuery;
+    Qt::CaseSensitivity          m_lastCs;
+    QVector<int>                 m_lastResults;
+};
+
+// ---------------------------------------------------------------------
+
+class PluginFilterModel : public QSortFilterProxyModel
+{
+public:
+
+    PluginFilterModel(PluginListModel* const source, QObject* const parent)
+        : QSortFilterProxyModel(parent),
+          m_index(source->m_rows)
+    {
+        setSourceModel(source);
+        setSortRole(PluginListModel::SortRole);
+    };
+
+    void setFilter(const QString& filter, Qt::CaseSensitivity cs)
+    {
+        m_accepted.clear();
+
+        if (!filter.isEmpty())
+        {
+            m_accepted.fill(false, sourceModel()->rowCount());
+            const QVector<int> rows = m_index.search(filter, cs);
+
+            for (int row : rows)
+                m_accepted[row] = true;
+        }
+
+        invalidateFilter();
+    };
+
+protected:
+
+    bool filterAcceptsRow(int row, const QModelIndex&) const override
+    {
+        return (m_accepted.isEmpty() || m_accepted.at(row));
+    };
+
+private:
+
+    PluginSearchIndex m_index;
+
+    /// Empty if there is no filter.
+    QVector<bool>     m_accepted;
 };
 
 // ---------------------------------------------------------------------
@@ -75,23 +433,55 @@ public:
 
     Private()
     {
+        loader = nullptr;
+        model  = nullptr;
+        proxy  = nullptr;
     };
 
-    QString                filter;
-    QList<PluginCheckBox*> boxes;
+    QString            filter;
+    PluginListModel*   model;
+    PluginFilterModel* proxy;
+    PluginLoader*      loader;
 };
 
 ConfigWidget::ConfigWidget(QWidget* const parent)
-    : QTreeWidget(parent),
+    : ConfigWidget(PluginLoader::instance(), parent)
+{
+}
+
+ConfigWidget::ConfigWidget(PluginLoader* const loader, QWidget* const parent)
+    : QTreeView(parent),
       d(new Private)
 {
+    d->loader = loader;
+    d->model  = new PluginListModel(this);
+    d->proxy  = new PluginFilterModel(d->model, this);
+
+    if (loader)
+    {
+        const auto infos = loader->pluginList();
+        d->model->m_rows.reserve(infos.count());
+
+        for (PluginLoader::Info* const info : infos)
+        {
+            if (info)
+            {
+                d->model->m_rows.append(PluginRow(info));
+            }
+        }
+    }
+
+    setModel(d->proxy);
     setRootIsDecorated(false);
+    setItemsExpandable(false);
+    setUniformRowHeights(true);
     setSelectionMode(QAbstractItemView::SingleSelection);
     setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
     setAllColumnsShowFocus(true);
     setSortingEnabled(true);
-    setColumnCount(4);
 
+    // Only visible rows are used to compute the size of columns.
+    header()->setResizeContentsPrecision(0);
     header()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
     header()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
     header()->setSectionResizeMode(2, QHeaderView::Stretch);
@@ -101,83 +491,82 @@ ConfigWidget::ConfigWidget(QWidget* const parent)
     setAutoFillBackground(false);
     viewport()->setAutoFillBackground(false);
 
-    PluginLoader* const loader = PluginLoader::instance();
-
-    if (loader)
-    {
-        const auto infos = loader->pluginList();
-        for (PluginLoader::Info* const info : infos)
-        {
-            if (info)
-            {
-                d->boxes.append(new PluginCheckBox(info, this));
-            }
-        }
-    }
-
     // Sort items by plugin names.
-    sortItems(0, Qt::AscendingOrder);
+    sortByColumn(0, Qt::AscendingOrder);
 }
 
 ConfigWidget::~ConfigWidget() = default;
 
 void ConfigWidget::apply()
 {
-    if (PluginLoader::instance())
+    PluginLoader* const loader = d->loader;
+
+    if (loader)
     {
         KSharedConfigPtr config = KSharedConfig::openConfig();
         KConfigGroup group      = config->group(QString::fromLatin1("KIPI/EnabledPlugin"));
+        const bool incremental  = loader->incrementalReplugEnabled();
 
-        for (PluginCheckBox* const item : std::as_const(d->boxes))
+        for (PluginRow& row : d->model->m_rows)
         {
-            bool orig = item->m_info->shouldLoad();
-            bool load = (item->checkState(0) == Qt::Checked);
+            bool orig = row.m_info->shouldLoad();
+            bool load = (row.m_state == Qt::Checked);
 
             if (orig != load)
             {
-                group.writeEntry(item->m_info->uname(), load);
-                item->m_info->setShouldLoad(load);
-
-                // See Bug #289779 - Plugins are not really freed / unplugged when disabled in the kipi setup dialog, always call reload()
-                // to reload plugins properly when the replug() signal is send.
-                item->m_info->reload();
+                group.writeEntry(row.m_info->uname(), load);
+                row.m_info->setShouldLoad(load);
+
+                if (incremental)
+                {
+                    loader->reloadPlugin(row.m_info);
+                }
+                else
+                {
+                    // See Bug #289779 - Plugins are not really freed / unplugged when disabled in the kipi setup dialog, always call reload()
+                    // to reload plugins properly when the replug() signal is send.
+                    row.m_info->reload();
+                }
             }
         }
 
         config->sync();
 
-        Q_EMIT PluginLoader::instance()->replug();
+        if (!incremental)
+        {
+            Q_EMIT loader->replug();
+        }
     }
 }
 
 void ConfigWidget::selectAll()
 {
-    for (PluginCheckBox* const item : std::as_const(d->boxes))
+    for (int i = 0; i < d->model->m_rows.count(); ++i)
     {
-        item->setCheckState(0, Qt::Checked);
+        d->model->setCheckState(i, Qt::Checked);
     }
 }
 
 void ConfigWidget::clearAll()
 {
-    for (PluginCheckBox* const item : std::as_const(d->boxes))
+    for (int i = 0; i < d->model->m_rows.count(); ++i)
     {
-        item->setCheckState(0, Qt::Unchecked);
+        d->model->setCheckState(i, Qt::Unchecked);
     }
 }
 
 int ConfigWidget::count() const
 {
-    return d->boxes.count();
+    return d->model->m_rows.count();
 }
 
 int ConfigWidget::actived() const
 {
     int actived = 0;
 
-    for (PluginCheckBox* const item : std::as_const(d->boxes))
+    for (const PluginRow& row : std::as_const(d->model->m_rows))
     {
-        if (item->checkState(0) == Qt::Checked)
+        if (row.m_state == Qt::Checked)
             actived++;
     }
 
@@ -186,36 +575,20 @@ int ConfigWidget::actived() const
 
 int ConfigWidget::visible() const
 {
-    int visible = 0;
-
-    for (PluginCheckBox* const item : std::as_const(d->boxes))
-    {
-        if (!item->isHidden())
-            visible++;
-    }
-
-    return visible;
+    return d->proxy->rowCount();
 }
 
 void ConfigWidget::setFilter(const QString& filter, Qt::CaseSensitivity cs)
 {
-    d->filter  = filter;
-    bool query = false;
+    d->filter = filter;
+    d->proxy->setFilter(filter, cs);
 
-    for (PluginCheckBox* const item : std::as_const(d->boxes))
-    {
-        if (item->contains(filter, cs))
-        {
-            query = true;
-            item->setHidden(false);
-        }
-        else
-        {
-            item->setHidden(true);
-        }
-    }
+    Q_EMIT signalSearchResult(d->proxy->rowCount() > 0);
+}
 
-    Q_EMIT signalSearchResult(query);
+void ConfigWidget::setHeaderLabels(const QStringList& labels)
+{
+    d->model->setHeaderLabels(labels);
 }
 
 QString ConfigWidget::filter() const
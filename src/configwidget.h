@@ -14,8 +14,8 @@
 
 // Qt includes
 
-#include <QTreeWidgetItem>
-#include <QTreeWidget>
+#include <QStringList>
+#include <QTreeView>
 
 // Local includes
 
@@ -30,16 +30,23 @@ namespace KIPI
  * @class ConfigWidget configwidget.h <KIPI/ConfigWidget>
  *
  * The ConfigWidget class.
+ *
+ * Plugins are listed through a model which reads their properties only when rows are shown,
+ * and which never loads a plugin library.
  */
-class LIBKIPI_EXPORT ConfigWidget : public QTreeWidget
+class LIBKIPI_EXPORT ConfigWidget : public QTreeView
 {
     Q_OBJECT
 
 public:
 
-    /** Default constructor.
+    /** Default constructor, listing plugins from PluginLoader::instance().
      */
     ConfigWidget(QWidget* const parent = nullptr);
+
+    /** Constructor listing plugins from @p loader.
+     */
+    ConfigWidget(PluginLoader* const loader, QWidget* const parent);
     ~ConfigWidget() override;
 
     /** Apply all changes about plugins selected to be hosted in KIPI host application.
@@ -74,6 +81,10 @@ public:
      */
     QString filter() const;
 
+    /** Set the labels of the columns: name, categories, description and author.
+     */
+    void setHeaderLabels(const QStringList& labels);
+
 Q_SIGNALS:
 
     /** Signal emitted when filtering is done through setFilter().
@@ -0,0 +1,241 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "filereadwritelockregistry.h"
+
+// Qt includes
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QReadWriteLock>
+
+// Local includes
+
+#include "libkipi_debug.h"
+#include "interface.h"
+
+namespace KIPI
+{
+
+namespace
+{
+
+const int s_stripeCount = 64;
+
+/** Files are identified by their URL, without redundant path segments and trailing slash.
+ */
+QString fileKey(const QUrl& url)
+{
+    return url.adjusted(QUrl::NormalizePathSegments | QUrl::StripTrailingSlash).toString();
+}
+
+} // namespace
+
+class Q_DECL_HIDDEN FileReadWriteLockRegistry::Private : public std::enable_shared_from_this<Private>
+{
+public:
+
+    /** Lock shared by all FileReadWriteLock of a file.
+     */
+    class Entry
+    {
+    public:
+
+        Entry()
+            : lock(QReadWriteLock::Recursive),
+              refs(0)
+        {
+        }
+
+        QReadWriteLock lock;
+
+        /// Number of FileReadWriteLock referring to this entry, protected by the stripe mutex.
+        int            refs;
+    };
+
+    class Stripe
+    {
+    public:
+
+        mutable QMutex          mutex;
+        QHash<QString, Entry*>  entries;
+    };
+
+    /** Lock handed to the host application, referring to the entry of its file. The handle keeps
+     *  the registry state alive until it is deleted.
+     */
+    class Handle : public FileReadWriteLock
+    {
+    public:
+
+        Handle(const std::shared_ptr<Private>& registry, const QString& key, Entry* const entry)
+            : m_registry(registry),
+              m_key(key),
+              m_entry(entry),
+              m_locks(0)
+        {
+        }
+
+        ~Handle() override
+        {
+            if (m_locks > 0)
+            {
+                qCWarning(LIBKIPI_LOG) << "FileReadWriteLock deleted while locked" << m_locks << "times: unlocking it";
+
+                while (m_locks > 0)
+                {
+                    unlock();
+                }
+            }
+
+            m_registry->release(m_key, m_entry);
+        }
+
+        void lockForRead() override
+        {
+            m_entry->lock.lockForRead();
+            locked(true);
+        }
+
+        void lockForWrite() override
+        {
+            m_entry->lock.lockForWrite();
+            locked(true);
+        }
+
+        bool tryLockForRead() override
+        {
+            return locked(m_entry->lock.tryLockForRead());
+        }
+
+        bool tryLockForRead(int timeout) override
+        {
+            return locked(m_entry->lock.tryLockForRead(timeout));
+        }
+
+        bool tryLockForWrite() override
+        {
+            return locked(m_entry->lock.tryLockForWrite());
+        }
+
+        bool tryLockForWrite(int timeout) override
+        {
+            return locked(m_entry->lock.tryLockForWrite(timeout));
+        }
+
+        void unlock() override
+        {
+            if (m_locks == 0)
+            {
+                qCWarning(LIBKIPI_LOG) << "FileReadWriteLock unlocked more often than locked";
+                return;
+            }
+
+            --m_locks;
+            m_entry->lock.unlock();
+        }
+
+    private:
+
+        bool locked(bool success)
+        {
+            if (success)
+            {
+                ++m_locks;
+            }
+
+            return success;
+        }
+
+    private:
+
+        const std::shared_ptr<Private> m_registry;
+        const QString                  m_key;
+        Entry* const                   m_entry;
+
+        /// Number of times this handle is locked.
+        int                            m_locks;
+    };
+
+public:
+
+    ~Private()
+    {
+        for (Stripe& stripe : stripes)
+        {
+            qDeleteAll(stripe.entries);
+        }
+    }
+
+    Stripe& stripe(const QString& key)
+    {
+        return stripes[qHash(key) % s_stripeCount];
+    }
+
+    FileReadWriteLock* acquire(const QUrl& url)
+    {
+        const QString key = fileKey(url);
+        Stripe& s         = stripe(key);
+        QMutexLocker lock(&s.mutex);
+
+        Entry*& entry = s.entries[key];
+
+        if (!entry)
+            entry = new Entry;
+
+        ++entry->refs;
+
+        return new Handle(shared_from_this(), key, entry);
+    }
+
+    /** Forget @p entry when its last handle is deleted. Handles are unlocked before, so the entry is free.
+     */
+    void release(const QString& key, Entry* const entry)
+    {
+        Stripe& s = stripe(key);
+        QMutexLocker lock(&s.mutex);
+
+        if (--entry->refs > 0)
+            return;
+
+        s.entries.remove(key);
+        delete entry;
+    }
+
+public:
+
+    Stripe stripes[s_stripeCount];
+};
+
+FileReadWriteLockRegistry::FileReadWriteLockRegistry()
+    : d(std::make_shared<Private>())
+{
+}
+
+FileReadWriteLockRegistry::~FileReadWriteLockRegistry()
+{
+}
+
+FileReadWriteLock* FileReadWriteLockRegistry::createReadWriteLock(const QUrl& url) const
+{
+    return d->acquire(url);
+}
+
+int FileReadWriteLockRegistry::count() const
+{
+    int total = 0;
+
+    for (const Private::Stripe& stripe : d->stripes)
+    {
+        QMutexLocker lock(&stripe.mutex);
+        total += stripe.entries.size();
+    }
+
+    return total;
+}
+
+} // namespace KIPI
@@ -0,0 +1,83 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KIPI_FILEREADWRITELOCKREGISTRY_H
+#define KIPI_FILEREADWRITELOCKREGISTRY_H
+
+// Std includes
+
+#include <memory>
+
+// Qt includes
+
+#include <QUrl>
+
+// Local includes
+
+#include "libkipi_export.h"
+
+namespace KIPI
+{
+
+class FileReadWriteLock;
+
+/** @class FileReadWriteLockRegistry filereadwritelockregistry.h <KIPI/FileReadWriteLockRegistry>
+
+    Registry of per-file reader/writer locks, which host applications can use to implement
+    Interface::createReadWriteLock() and support HostSupportsReadWriteLock feature:
+
+    \code
+
+    FileReadWriteLock* MyKipiInterface::createReadWriteLock(const QUrl& url) const
+    {
+        return m_fileLocks.createReadWriteLock(url);
+    }
+
+    \endcode
+
+    All locks created for the same file share one recursive QReadWriteLock. Files are identified by their
+    normalized URL, and spread over independent stripes, each protected by its own mutex, so that creating
+    locks from several threads does not contend. Locking and unlocking do not touch the stripes.
+
+    The shared lock of a file is deleted when no FileReadWriteLock refers to it anymore, so the registry
+    only holds the files currently in use. A FileReadWriteLock deleted while it is still locked is unlocked
+    as often as it was locked, with a warning.
+
+    Locks share the state of the registry which created them, and can be deleted after it.
+ */
+class LIBKIPI_EXPORT FileReadWriteLockRegistry
+{
+public:
+
+    FileReadWriteLockRegistry();
+    ~FileReadWriteLockRegistry();
+
+    /**
+     * Create a lock for the file at @p url. The caller owns the returned object, which should be deleted
+     * once unlocked as often as it was locked. Can be called from any thread.
+     */
+    FileReadWriteLock* createReadWriteLock(const QUrl& url) const;
+
+    /**
+     * Return the number of files which have a lock in use.
+     */
+    int count() const;
+
+private:
+
+    // Disable
+    FileReadWriteLockRegistry(const FileReadWriteLockRegistry&);
+    FileReadWriteLockRegistry& operator=(const FileReadWriteLockRegistry&);
+
+private:
+
+    class Private;
+    std::shared_ptr<Private> const d;
+};
+
+} // namespace KIPI
+
+#endif /* KIPI_FILEREADWRITELOCKREGISTRY_H */
@@ -0,0 +1,132 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "imagecollectionsnapshot.h"
+
+// Qt includes
+
+#include <QHash>
+#include <QStringList>
+#include <QSharedData>
+
+namespace KIPI
+{
+
+class Q_DECL_HIDDEN ImageCollectionSnapshot::Private : public QSharedData
+{
+public:
+
+    Private()
+    {
+        version = 0;
+    }
+
+    quint64                version;
+    QList<ImageCollection> albums;
+    QStringList            names;
+
+    /// Album name to position in albums list.
+    QHash<QString, int>    index;
+};
+
+ImageCollectionSnapshot::ImageCollectionSnapshot()
+    : d(new Private)
+{
+}
+
+ImageCollectionSnapshot::ImageCollectionSnapshot(const QList<ImageCollection>& albums, quint64 version)
+    : d(new Private)
+{
+    d->version = version;
+    d->albums.reserve(albums.size());
+    d->names.reserve(albums.size());
+    d->index.reserve(albums.size());
+
+    for (const ImageCollection& album : albums)
+    {
+        if (!album.isValid())
+            continue;
+
+        const QString name = album.name();
+
+        d->index.insert(name, d->albums.size());
+        d->albums.append(album);
+        d->names.append(name);
+    }
+}
+
+ImageCollectionSnapshot::ImageCollectionSnapshot(const ImageCollectionSnapshot& other)
+    : d(other.d)
+{
+}
+
+ImageCollectionSnapshot::~ImageCollectionSnapshot()
+{
+}
+
+ImageCollectionSnapshot& ImageCollectionSnapshot::operator=(const ImageCollectionSnapshot& other)
+{
+    d = other.d;
+    return *this;
+}
+
+quint64 ImageCollectionSnapshot::version() const
+{
+    return d->version;
+}
+
+bool ImageCollectionSnapshot::isValid() const
+{
+    return (d->version != 0);
+}
+
+int ImageCollectionSnapshot::count() const
+{
+    return d->albums.size();
+}
+
+QList<ImageCollection> ImageCollectionSnapshot::albums() const
+{
+    return d->albums;
+}
+
+bool ImageCollectionSnapshot::contains(const QString& name) const
+{
+    return d->index.contains(name);
+}
+
+ImageCollection ImageCollectionSnapshot::album(const QString& name) const
+{
+    QHash<QString, int>::const_iterator it = d->index.constFind(name);
+
+    if (it == d->index.constEnd())
+        return ImageCollection();
+
+    return d->albums.at(it.value());
+}
+
+QList<ImageCollection> ImageCollectionSnapshot::addedSince(const ImageCollectionSnapshot& older) const
+{
+    QList<ImageCollection> added;
+
+    if (older.d == d || older.version() == version())
+        return added;
+
+    for (int i = 0; i < d->names.size(); ++i)
+    {
+        if (!older.d->index.contains(d->names.at(i)))
+            added.append(d->albums.at(i));
+    }
+
+    return added;
+}
+
+QList<ImageCollection> ImageCollectionSnapshot::removedSince(const ImageCollectionSnapshot& older) const
+{
+    return older.addedSince(*this);
+}
+
+} // namespace KIPI
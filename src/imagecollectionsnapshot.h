@@ -0,0 +1,92 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KIPI_IMAGECOLLECTIONSNAPSHOT_H
+#define KIPI_IMAGECOLLECTIONSNAPSHOT_H
+
+// Qt includes
+
+#include <QList>
+#include <QString>
+#include <QSharedDataPointer>
+
+// Local includes
+
+#include "imagecollection.h"
+#include "libkipi_export.h"
+
+namespace KIPI
+{
+
+/** @class ImageCollectionSnapshot imagecollectionsnapshot.h <KIPI/ImageCollectionSnapshot>
+
+    Holds a versioned, read-only copy of the albums list returned by KIPI::Interface::allAlbums().
+    Snapshots are implicitly shared, so plugins can keep one around and compare it with a newer one
+    taken from KIPI::Interface::albumsSnapshot() when KIPI::Interface::albumsChanged() is emitted.
+    Albums are identified by their name.
+ */
+class LIBKIPI_EXPORT ImageCollectionSnapshot
+{
+
+public:
+
+    ImageCollectionSnapshot();
+    ImageCollectionSnapshot(const QList<ImageCollection>& albums, quint64 version);
+    ImageCollectionSnapshot(const ImageCollectionSnapshot& other);
+    ~ImageCollectionSnapshot();
+
+    ImageCollectionSnapshot& operator=(const ImageCollectionSnapshot& other);
+
+    /**
+     * Returns the version of the albums list this snapshot was taken from.
+     * Two snapshots with the same version hold the same albums.
+     */
+    quint64 version() const;
+
+    /**
+     * Returns true if this snapshot was taken from the host application.
+     */
+    bool isValid() const;
+
+    /**
+     * Returns the number of albums hosted by the snapshot.
+     */
+    int count() const;
+
+    /**
+     * Returns the albums in the same order than KIPI::Interface::allAlbums().
+     */
+    QList<ImageCollection> albums() const;
+
+    /**
+     * Returns true if an album named @p name is hosted by the snapshot.
+     */
+    bool contains(const QString& name) const;
+
+    /**
+     * Returns the album named @p name, or an invalid collection if it is not hosted by the snapshot.
+     */
+    ImageCollection album(const QString& name) const;
+
+    /**
+     * Returns the albums hosted by this snapshot which are not in the @p older one.
+     */
+    QList<ImageCollection> addedSince(const ImageCollectionSnapshot& older) const;
+
+    /**
+     * Returns the albums hosted by the @p older snapshot which are not in this one anymore.
+     */
+    QList<ImageCollection> removedSince(const ImageCollectionSnapshot& older) const;
+
+private:
+
+    class Private;
+    QSharedDataPointer<Private> d;
+};
+
+} // namespace KIPI
+
+#endif /* KIPI_IMAGECOLLECTIONSNAPSHOT_H */
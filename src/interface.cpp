@@ -16,6 +16,9 @@
 #include <QImageReader>
 #include <QImageWriter>
 #include <QDir>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicInt>
 
 // Local includes
 
@@ -23,9 +26,11 @@
 #include "libkipi_debug.h"
 #include "imageinfo.h"
 #include "imagecollection.h"
+#include "imagecollectionsnapshot.h"
 #include "imagecollectionselector.h"
 #include "imageinfoshared.h"
 #include "pluginloader.h"
+#include "profiler.h"
 #include "uploadwidget.h"
 
 // Macros
@@ -43,11 +48,145 @@ inline void initLibkipiResource()
     Q_INIT_RESOURCE(libkipi);
 }
 
+namespace
+{
+
+/**
+ * Names of KIPI::Features, as listed in X-KIPI-ReqFeatures property of plugins.
+ * They are dispatched at compile time into a hash table without collision, so a name
+ * is resolved with one hash computation and one string comparison.
+ */
+struct FeatureName
+{
+    const char* name;
+    int         flag;
+};
+
+constexpr FeatureName s_featureNames[] =
+{
+    { "CollectionsHaveComments",        KIPI::CollectionsHaveComments        },
+    { "ImagesHasComments",              KIPI::ImagesHasComments              },
+    { "ImagesHasTime",                  KIPI::ImagesHasTime                  },
+    { "HostSupportsDateRanges",         KIPI::HostSupportsDateRanges         },
+    { "HostAcceptNewImages",            KIPI::HostAcceptNewImages            },
+    { "ImagesHasTitlesWritable",        KIPI::ImagesHasTitlesWritable        },
+    { "CollectionsHaveCategory",        KIPI::CollectionsHaveCategory        },
+    { "CollectionsHaveCreationDate",    KIPI::CollectionsHaveCreationDate    },
+    { "HostSupportsProgressBar",        KIPI::HostSupportsProgressBar        },
+    { "HostSupportsTags",               KIPI::HostSupportsTags               },
+    { "HostSupportsRating",             KIPI::HostSupportsRating             },
+    { "HostSupportsThumbnails",         KIPI::HostSupportsThumbnails         },
+    { "HostSupportsReadWriteLock",      KIPI::HostSupportsReadWriteLock      },
+    { "HostSupportsPickLabel",          KIPI::HostSupportsPickLabel          },
+    { "HostSupportsColorLabel",         KIPI::HostSupportsColorLabel         },
+    { "HostSupportsItemReservation",    KIPI::HostSupportsItemReservation    },
+    { "HostSupportsPreviews",           KIPI::HostSupportsPreviews           },
+    { "HostSupportsRawProcessing",      KIPI::HostSupportsRawProcessing      },
+    { "HostSupportsMetadataProcessing", KIPI::HostSupportsMetadataProcessing },
+    { "HostSupportsSaveImages",         KIPI::HostSupportsSaveImages         }
+};
+
+constexpr quint32 s_fnvOffset        = 2166136261u;
+constexpr quint32 s_fnvPrime         = 16777619u;
+constexpr int     s_featureTableSize = 128;
+
+/// FNV-1a hash of a feature name.
+constexpr quint32 featureHash(const char* name)
+{
+    quint32 hash = s_fnvOffset;
+
+    for ( ; *name ; ++name)
+    {
+        hash = (hash ^ quint32(static_cast<unsigned char>(*name))) * s_fnvPrime;
+    }
+
+    return hash;
+}
+
+struct FeatureTable
+{
+    FeatureName slots[s_featureTableSize];
+    int         allFlags;
+    bool        perfect;
+};
+
+constexpr FeatureTable makeFeatureTable()
+{
+    FeatureTable table = {};
+    table.perfect      = true;
+
+    for (const FeatureName& feature : s_featureNames)
+    {
+        FeatureName& slot = table.slots[featureHash(feature.name) % s_featureTableSize];
+
+        if (slot.name)
+            table.perfect = false;
+
+        slot            = feature;
+        table.allFlags |= feature.flag;
+    }
+
+    return table;
+}
+
+constexpr FeatureTable s_featureTable = makeFeatureTable();
+
+static_assert(s_featureTable.perfect,
+              "Feature names collide in the hash table: increase s_featureTableSize");
+static_assert(s_featureTable.allFlags == ((KIPI::HostSupportsSaveImages << 1) - 1),
+              "A KIPI::Features value is missing in s_featureNames");
+
+/// Return the KIPI::Features flag named @p name, or 0 if the name is unknown.
+int featureFromName(const QString& name)
+{
+    quint32 hash = s_fnvOffset;
+
+    for (const QChar& c : name)
+    {
+        // Feature names are plain ASCII.
+
+        if (c.unicode() > 0x7F)
+            return 0;
+
+        hash = (hash ^ quint32(c.unicode())) * s_fnvPrime;
+    }
+
+    const FeatureName& slot = s_featureTable.slots[hash % s_featureTableSize];
+
+    if (slot.name && (name == QLatin1String(slot.name)))
+        return slot.flag;
+
+    return 0;
+}
+
+} // namespace
+
 namespace KIPI
 {
 
+class Q_DECL_HIDDEN Interface::Private
+{
+public:
+
+    Private()
+        : features(-1)
+    {
+        snapshotSerial = 0;
+    }
+
+    /// Value returned by features(), or -1 if not yet queried.
+    QAtomicInt              features;
+
+    QMutex                  snapshotMutex;
+    ImageCollectionSnapshot snapshot;
+
+    /// Used to version snapshots when host application do not track albums changes.
+    quint64                 snapshotSerial;
+};
+
 Interface::Interface(QObject* const parent, const QString& name)
-    : QObject(parent)
+    : QObject(parent),
+      d(new Private)
 {
     initLibkipiResource();
 
@@ -70,52 +209,33 @@ void Interface::refreshImages(const QList<QUrl>&)
 
 bool Interface::hasFeature(Features feature) const
 {
-    return (features() & feature) != 0;
+    int flags = d->features.loadAcquire();
+
+    if (flags == -1)
+    {
+        flags = features();
+        d->features.storeRelease(flags);
+    }
+
+    return (flags & feature) != 0;
+}
+
+void Interface::refreshFeatures()
+{
+    d->features.storeRelease(-1);
 }
 
 bool Interface::hasFeature( const QString& feature ) const
 {
-    if       ( feature == QString::fromLatin1("CollectionsHaveComments" ))
-        return hasFeature( CollectionsHaveComments );
-    else if  ( feature == QString::fromLatin1("CollectionsHaveCategory" ))
-        return hasFeature( CollectionsHaveCategory );
-    else if  ( feature == QString::fromLatin1("CollectionsHaveCreationDate" ))
-        return hasFeature( CollectionsHaveCreationDate );
-    else if  ( feature == QString::fromLatin1("ImagesHasComments" ))
-        return hasFeature( ImagesHasComments );
-    else if  ( feature == QString::fromLatin1("ImagesHasTime" ))
-        return hasFeature( ImagesHasTime );
-    else if  ( feature == QString::fromLatin1("ImagesHasTitlesWritable" ))
-        return hasFeature( ImagesHasTitlesWritable );
-    else if  ( feature == QString::fromLatin1("HostSupportsThumbnails" ))
-        return hasFeature( HostSupportsThumbnails );
-    else if  ( feature == QString::fromLatin1("HostSupportsReadWriteLock" ))
-        return hasFeature( HostSupportsReadWriteLock );
-    else if  ( feature == QString::fromLatin1("HostSupportsDateRanges" ))
-        return hasFeature( HostSupportsDateRanges );
-    else if  ( feature == QString::fromLatin1("HostAcceptNewImages" ))
-        return hasFeature( HostAcceptNewImages );
-    else if  ( feature == QString::fromLatin1("HostSupportsProgressBar" ))
-        return hasFeature( HostSupportsProgressBar );
-    else if  ( feature == QString::fromLatin1("HostSupportsTags" ))
-        return hasFeature( HostSupportsTags );
-    else if  ( feature == QString::fromLatin1("HostSupportsRating" ))
-        return hasFeature( HostSupportsRating );
-    else if  ( feature == QString::fromLatin1("HostSupportsPickLabel" ))
-        return hasFeature( HostSupportsPickLabel );
-    else if  ( feature == QString::fromLatin1("HostSupportsColorLabel" ))
-        return hasFeature( HostSupportsColorLabel );
-    else if  ( feature == QString::fromLatin1("HostSupportsItemReservation" ))
-        return hasFeature( HostSupportsItemReservation );
-    else if  ( feature == QString::fromLatin1("HostSupportsPreviews" ))
-        return hasFeature( HostSupportsPreviews );
-    else if  ( feature == QString::fromLatin1("HostSupportsRawProcessing" ))
-        return hasFeature( HostSupportsRawProcessing );
-    else
+    const int flag = featureFromName(feature);
+
+    if (flag == 0)
     {
         qCWarning(LIBKIPI_LOG) << "Unknown feature asked for in KIPI::Interface::hasFeature(): " << feature;
         return false;
     }
+
+    return hasFeature( static_cast<Features>(flag) );
 }
 
 bool Interface::addImage(const QUrl&, QString&)
@@ -147,6 +267,37 @@ QList<ImageCollection> Interface::allAlbums()
     return QList<ImageCollection>();
 }
 
+quint64 Interface::albumsVersion() const
+{
+    return 0;
+}
+
+ImageCollectionSnapshot Interface::albumsSnapshot()
+{
+    QMutexLocker lock(&d->snapshotMutex);
+    const quint64 version = albumsVersion();
+
+    if (version != 0 && d->snapshot.isValid() && d->snapshot.version() == version)
+    {
+        return d->snapshot;
+    }
+
+    Profiler::Scope scope("Interface::albumsSnapshot");
+
+    if (version != 0)
+    {
+        d->snapshot = ImageCollectionSnapshot(allAlbums(), version);
+    }
+    else
+    {
+        // Host do not track albums changes: the snapshot is always rebuilt, with a version number
+        // which only identify it.
+        d->snapshot = ImageCollectionSnapshot(allAlbums(), ++d->snapshotSerial);
+    }
+
+    return d->snapshot;
+}
+
 int Interface::features() const
 {
     PrintWarningMessage();
@@ -271,6 +422,41 @@ bool Interface::itemIsReserved(const QUrl&, QString* const) const
     return false;
 }
 
+QList<QUrl> Interface::reserveItemsForAction(const QList<QUrl>& urls, QObject* const reservingObject,
+                                             const QString& descriptionOfAction) const
+{
+    QList<QUrl> reserved;
+
+    for (const QUrl& url : urls)
+    {
+        if (reserveForAction(url, reservingObject, descriptionOfAction))
+            reserved.append(url);
+    }
+
+    return reserved;
+}
+
+void Interface::clearReservations(const QList<QUrl>& urls, QObject* const reservingObject)
+{
+    for (const QUrl& url : urls)
+    {
+        clearReservation(url, reservingObject);
+    }
+}
+
+QList<QUrl> Interface::reservedItems(const QList<QUrl>& urls) const
+{
+    QList<QUrl> reserved;
+
+    for (const QUrl& url : urls)
+    {
+        if (itemIsReserved(url))
+            reserved.append(url);
+    }
+
+    return reserved;
+}
+
 FileReadWriteLock* Interface::createReadWriteLock(const QUrl&) const
 {
     PrintWarningMessageFeature("HostSupportsReadWriteLock");
@@ -320,6 +506,7 @@ FileReadLocker::FileReadLocker(ImageInfoShared* const info)
 FileReadLocker::~FileReadLocker()
 {
     unlock();
+    delete d;
 }
 
 FileReadWriteLock* FileReadLocker::fileReadWriteLock() const
@@ -360,6 +547,7 @@ FileWriteLocker::FileWriteLocker(ImageInfoShared* const info)
 FileWriteLocker::~FileWriteLocker()
 {
     unlock();
+    delete d;
 }
 
 FileReadWriteLock* FileWriteLocker::fileReadWriteLock() const
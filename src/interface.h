@@ -43,6 +43,7 @@ namespace KIPI
 {
 
 class ImageCollection;
+class ImageCollectionSnapshot;
 class ImageCollectionSelector;
 class ImageInfo;
 class ImageInfoShared;
@@ -80,7 +81,7 @@ enum Features
     HostSupportsSaveImages         = 1 << 19  /** This feature specifies that host application can save image files.                                                                */
 };
 
-// NOTE: When a new item is add to Features, please don't forget to patch Interface::hasFeature().
+// NOTE: When a new item is add to Features, please don't forget to patch the feature names table in interface.cpp.
 
 /**
  * The EditHint enum.
@@ -268,6 +269,7 @@ public:
     /**
      * Tells whether the host application under which the plugin currently executes a given feature.
      * See KIPI::Features for details on the individual features.
+     * The value returned by features() is queried once, then cached until refreshFeatures() is called.
      */
     bool hasFeature(Features feature) const;
 
@@ -290,6 +292,23 @@ public:
      */
     virtual QList<ImageCollection> allAlbums() = 0;
 
+    /**
+     * Returns a snapshot of the albums list returned by allAlbums().
+     * The snapshot is cached and only rebuilt when albumsVersion() changes, so plugins
+     * can call this method as often as they want with hosts which implement albumsVersion().
+     * Use ImageCollectionSnapshot::addedSince() and ImageCollectionSnapshot::removedSince()
+     * to find what changed between two snapshots.
+     */
+    ImageCollectionSnapshot albumsSnapshot();
+
+    /**
+     * Returns a number that host application must change each time the list of albums
+     * returned by allAlbums() or the contents of these albums change, and before albumsChanged()
+     * is emitted. The default implementation returns 0, meaning that host application do not
+     * track changes, and albumsSnapshot() will call allAlbums() every time.
+     */
+    virtual quint64 albumsVersion() const;
+
     /**
      * Returns the image info container for item pointed by @p url.
      */
@@ -363,6 +382,7 @@ public:
       To close progress item in kipi host, for example when all is done in plugin, use progressCompleted() method.
       If you Host do not re-implement this method, value returned is a null string.
       You must re-implement this method if your host support HostSupportsProgressBar feature.
+      Plugins processing many items from several threads should use a ProgressItem, which coalesces updates.
     */
     virtual QString progressScheduled(const QString& title, bool canBeCanceled, bool hasThumb) const;
 
@@ -416,12 +436,41 @@ public:
      */
     virtual bool itemIsReserved(const QUrl& url, QString* const descriptionOfAction = nullptr) const;
 
+    /**
+     * Supported if HostSupportsItemReservation
+     *
+     * Reserves all @p urls in one call, as reserveForAction() does for one item, and returns the items
+     * which were reserved. Hosts should emit itemsReservedForAction() once for the whole batch.
+     *
+     * The default implementation calls reserveForAction() for each item. Hosts can implement all
+     * reservation methods with a ReservationTable.
+     */
+    virtual QList<QUrl> reserveItemsForAction(const QList<QUrl>& urls, QObject* const reservingObject,
+                                              const QString& descriptionOfAction) const;
+
+    /**
+     * Supported if HostSupportsItemReservation
+     *
+     * Clears the reservations of all @p urls made by @p reservingObject, as clearReservation() does for one item.
+     * The default implementation calls clearReservation() for each item.
+     */
+    virtual void clearReservations(const QList<QUrl>& urls, QObject* const reservingObject);
+
+    /**
+     * Supported if HostSupportsItemReservation
+     *
+     * Returns the items of @p urls which are reserved. The default implementation calls itemIsReserved() for each item.
+     */
+    virtual QList<QUrl> reservedItems(const QList<QUrl>& urls) const;
+
     /**
      * Supported if HostSupportsReadWriteLock
      * Creates a ReadWriteLock for the given URL.
      * You must unlock the FileReadWriteLock as often as you locked.
-     * Deleting the object does not unlock it.
+     * Deleting the object does not unlock it. The caller owns the returned object: a new object
+     * must be returned for each call, as FileReadLocker and FileWriteLocker delete it.
      * The implementation from KIPI host application must be thread-safe.
+     * Hosts can use a FileReadWriteLockRegistry to create the locks.
      *
      */
     virtual FileReadWriteLock* createReadWriteLock(const QUrl& url) const;
@@ -471,6 +520,13 @@ Q_SIGNALS:
      */
     void currentAlbumChanged(bool hasSelection);
 
+    /**
+     * Emit when the list of albums returned by allAlbums() has changed from host application,
+     * after albumsVersion() have been updated. Plugins holding an ImageCollectionSnapshot
+     * can call albumsSnapshot() to refresh it.
+     */
+    void albumsChanged();
+
     /** Emit when host application has rendered item thumbnail. See asynchronous thumbnail() and thumbnails()
      *  methods for details.
      */
@@ -493,6 +549,14 @@ Q_SIGNALS:
     void reservedForAction(const QUrl& url, const QString& descriptionOfAction);
     void reservationCleared(const QUrl& url);
 
+    /**
+     * Supported if HostSupportsItemReservation
+     *
+     * Emitted once per batch from reserveItemsForAction() and clearReservations(), respectively.
+     * */
+    void itemsReservedForAction(const QList<QUrl>& urls, const QString& descriptionOfAction);
+    void reservationsCleared(const QList<QUrl>& urls);
+
 protected:
 
     /**
@@ -500,12 +564,21 @@ protected:
      */
     virtual int features() const = 0;
 
+    /**
+     * Host application must call this method if the value returned by features() change at run-time,
+     * to drop the value cached by hasFeature().
+     */
+    void refreshFeatures();
+
 private:
 
     bool hasFeature(const QString& feature) const;
 
 private:
 
+    class Private;
+    std::unique_ptr<Private> const d;
+
     friend class PluginLoader;
 };
 
@@ -519,6 +592,7 @@ private:
  * classes, created on the stack, as unlocking will be done automatically for you.
  *
  * The API is modelled according to the QReadLocker/QWriteLocker classes.
+ * The lock returned by Interface::createReadWriteLock() is deleted with the locker.
  *
  * @note Operations are no-ops and fileReadWriteLock() is a nullptr if not HostSupportsReadWriteLock.
  */
@@ -18,6 +18,17 @@
 #include <QDir>
 #include <QAction>
 #include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QGlobalStatic>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QTimer>
+#include <QUrl>
 
 // KF includes
 
@@ -28,11 +39,222 @@
 #include "libkipi_version.h"
 #include "libkipi_debug.h"
 #include "interface.h"
+#include "imagecollection.h"
 #include "pluginloader.h"
+#include "profiler.h"
 
 namespace KIPI
 {
 
+static void flushMergeCacheAtExit();
+
+/** Keys of the merged XML files written by Plugin::mergeXMLFile(), with the size and the time of
+ *  modification of each file when it was written. A merge is skipped when its inputs give the same
+ *  key and the file was not changed since, for example by the toolbar editor. The keys are saved
+ *  once after all plugins of a batch are merged, and when the application exits.
+ *
+ *  The hash and the index of the host menus are also kept here, so that they are computed once for
+ *  all plugins, until the host document changes.
+ */
+class Q_DECL_HIDDEN MergeCache
+{
+public:
+
+    class Entry
+    {
+    public:
+
+        QByteArray key;
+        qint64     size     = -1;
+        qint64     modified = -1;
+    };
+
+public:
+
+    bool isMerged(const QString& localUI, const QByteArray& key)
+    {
+        QMutexLocker lock(&mutex);
+        load();
+
+        const QFileInfo fi(localUI);
+        const auto it = entries.constFind(localUI);
+
+        return (it != entries.constEnd() && it->key == key && fi.exists() &&
+                it->size == fi.size() && it->modified == fi.lastModified().toMSecsSinceEpoch());
+    }
+
+    void setMerged(const QString& localUI, const QByteArray& key)
+    {
+        QMutexLocker lock(&mutex);
+        load();
+
+        const QFileInfo fi(localUI);
+        Entry entry;
+        entry.key      = key;
+        entry.size     = fi.size();
+        entry.modified = fi.lastModified().toMSecsSinceEpoch();
+        entries.insert(localUI, entry);
+
+        if (dirty)
+            return;
+
+        dirty = true;
+
+        // Plugins are merged one after the other in the GUI thread: save once when they are all done.
+
+        if (QCoreApplication::instance())
+        {
+            QTimer::singleShot(0, QCoreApplication::instance(), [this]() { flush(); });
+        }
+    }
+
+    /** Return the hash of the host document @p doc. It is computed only when the document changes,
+     *  as KXMLGUIClient replaces its document when its XML file is reloaded.
+     */
+    QByteArray hostDocumentKey(const QDomDocument& doc)
+    {
+        QMutexLocker lock(&mutex);
+
+        if (doc != hostDoc)
+        {
+            hostDoc     = doc;
+            hostKey     = QCryptographicHash::hash(doc.toByteArray(), QCryptographicHash::Sha1);
+            hostIndexed = false;
+            hostPaths.clear();
+        }
+
+        return hostKey;
+    }
+
+    bool hostIndex(const QByteArray& key, QHash<QString, QList<QDomElement> >& index)
+    {
+        QMutexLocker lock(&mutex);
+
+        if (!hostIndexed || key != hostKey)
+            return false;
+
+        index = hostPaths;
+
+        return true;
+    }
+
+    void setHostIndex(const QByteArray& key, const QHash<QString, QList<QDomElement> >& index)
+    {
+        QMutexLocker lock(&mutex);
+
+        if (key != hostKey)
+            return;
+
+        hostIndexed = true;
+        hostPaths   = index;
+    }
+
+    /** Save the keys changed since the last save.
+     */
+    void flush()
+    {
+        QMutexLocker lock(&mutex);
+
+        if (!dirty)
+            return;
+
+        dirty = false;
+        save();
+    }
+
+private:
+
+    static QString cacheFile()
+    {
+        return (QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+                QLatin1String("/kipi-xmlmerge.cache"));
+    }
+
+    void load()
+    {
+        if (loaded)
+            return;
+
+        loaded = true;
+        qAddPostRoutine(flushMergeCacheAtExit);
+
+        QFile file(cacheFile());
+
+        if (!file.open(QIODevice::ReadOnly))
+            return;
+
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_5_15);
+
+        quint32 magic = 0;
+        qint32  count = 0;
+        in >> magic >> count;
+
+        if (magic != s_magic)
+            return;
+
+        for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i)
+        {
+            QString localUI;
+            Entry   entry;
+            in >> localUI >> entry.key >> entry.size >> entry.modified;
+            entries.insert(localUI, entry);
+        }
+    }
+
+    void save() const
+    {
+        QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+        QSaveFile file(cacheFile());
+
+        if (!file.open(QIODevice::WriteOnly))
+        {
+            qCWarning(LIBKIPI_LOG) << "Cannot write XML merge cache" << cacheFile();
+            return;
+        }
+
+        QDataStream out(&file);
+        out.setVersion(QDataStream::Qt_5_15);
+        out << s_magic << qint32(entries.size());
+
+        for (auto it = entries.constBegin(); it != entries.constEnd(); ++it)
+        {
+            out << it.key() << it->key << it->size << it->modified;
+        }
+
+        file.commit();
+    }
+
+private:
+
+    static const quint32                s_magic = 0x4B584D43; // "KXMC"
+
+    QMutex                              mutex;
+    bool                                loaded      = false;
+    bool                                dirty       = false;
+    QHash<QString, Entry>               entries;
+
+    /// Hash and index of the menus of the last host document merged, which is kept alive with them.
+    QByteArray                          hostKey;
+    QDomDocument                        hostDoc;
+    bool                                hostIndexed = false;
+    QHash<QString, QList<QDomElement> > hostPaths;
+};
+
+Q_GLOBAL_STATIC(MergeCache, s_mergeCache)
+
+/** Save the keys not saved yet, while the application cache directory can still be located.
+ */
+static void flushMergeCacheAtExit()
+{
+    if (s_mergeCache.exists())
+    {
+        s_mergeCache->flush();
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------------
+
 class Q_DECL_HIDDEN Plugin::Private
 {
 public:
@@ -44,10 +266,23 @@ public:
         defaultCategory = InvalidCategory;
     }
 
-    ActionCategoryMap actionsCat;
-    QWidget*          defaultWidget;
-    QString           uiBaseName;
-    Category          defaultCategory;
+    /** Actions added while a widget was the default one.
+     */
+    class WidgetActions
+    {
+    public:
+
+        /// In the order of addition.
+        QList<QAction*>           actions;
+        QHash<QAction*, Category> categories;
+    };
+
+    QHash<QWidget*, WidgetActions> actionsCat;
+    QWidget*                       defaultWidget;
+    QString                        uiBaseName;
+    Category                       defaultCategory;
+
+    QHash<QString, Operation> operations;
 
 public:
 
@@ -57,14 +292,16 @@ public:
     public:
 
         static QDomElement makeElement(QDomDocument& domDoc, const QDomElement& from);
-        static void        buildPaths(const QDomElement& original, const QDomNodeList& localNodes, QHashPath& paths);
+        static void        buildHostIndex(const QDomElement& original, QHashPath& index);
+        static void        buildPaths(const QHashPath& hostIndex, const QDomNodeList& localNodes, QHashPath& paths);
         static int         findByNameAttr(const QDomNodeList& list, const QDomElement& node);
-        static void        removeDisabledActions(QDomElement& elem);
+        static void        removeDisabledActions(const PluginLoader* const loader, QDomElement& elem);
 
     private:
 
         XMLParser();
-        static void buildPaths(const QDomElement& original, const QDomNodeList& localNodes, QHashPath& paths, QDomElemList& stack);
+        static QString nodeKey(const QString& tagName, const QString& name);
+        static void    buildHostIndex(const QDomElement& original, QHashPath& index, QDomElemList& stack);
     };
 };
 
@@ -76,26 +313,53 @@ QDomElement Plugin::Private::XMLParser::makeElement(QDomDocument& domDoc, const
     QDomElement elem            = domDoc.createElement(from.tagName());
     QDomNamedNodeMap attributes = from.attributes();
 
+    // Attributes are copied by value: elements of the host document are used as is, without being cloned,
+    // and moving their attribute nodes would change them.
+
     for (int i = 0; i < attributes.size(); ++i)
     {
-        QDomAttr attr = attributes.item(i).toAttr();
+        const QDomAttr attr = attributes.item(i).toAttr();
 
-        if (attr.name() != QString::fromLatin1("alreadyVisited"))
-            elem.setAttributeNode(attr);
+        if (attr.name() != QLatin1String("alreadyVisited"))
+            elem.setAttribute(attr.name(), attr.value());
     }
 
     return elem;
 }
 
-void Plugin::Private::XMLParser::buildPaths(const QDomElement& original, const QDomNodeList& localNodes, QHashPath& paths)
+void Plugin::Private::XMLParser::buildHostIndex(const QDomElement& original, QHashPath& index)
 {
     /*
-     * For each child element of "local", we will construct the path from the
-     * "original" element to first appearance of the respective child in the
-     * subtree.
+     * For each menu element of the "original" subtree, we will store the path from
+     * the "original" element to the menu, hashed by tag and name. The index only
+     * depends on the host document, so it is shared by the merges of all plugins.
      */
     QDomElemList stack;
-    buildPaths(original, localNodes, paths, stack);
+    buildHostIndex(original, index, stack);
+}
+
+void Plugin::Private::XMLParser::buildPaths(const QHashPath& hostIndex, const QDomNodeList& localNodes, QHashPath& paths)
+{
+    /*
+     * For each child element of "local", we look up the path from the "original"
+     * element to the respective child in the host index.
+     */
+    for (int i = 0; i < localNodes.size(); ++i)
+    {
+        const QDomElement e = localNodes.item(i).toElement();
+        const QString name  = e.attribute(QString::fromLatin1("name"));
+        const auto it       = hostIndex.constFind(nodeKey(e.tagName(), name));
+
+        if (it != hostIndex.constEnd())
+        {
+            paths[name] = it.value();
+        }
+    }
+}
+
+QString Plugin::Private::XMLParser::nodeKey(const QString& tagName, const QString& name)
+{
+    return (tagName + QLatin1Char('\n') + name);
 }
 
 int Plugin::Private::XMLParser::findByNameAttr(const QDomNodeList& list, const QDomElement& node)
@@ -114,10 +378,12 @@ int Plugin::Private::XMLParser::findByNameAttr(const QDomNodeList& list, const Q
     return -1;
 }
 
-void Plugin::Private::XMLParser::removeDisabledActions(QDomElement& elem)
+void Plugin::Private::XMLParser::removeDisabledActions(const PluginLoader* const loader, QDomElement& elem)
 {
-    QDomNodeList actionList      = elem.elementsByTagName(QString::fromLatin1("Action"));
-    QStringList  disabledActions = PluginLoader::instance()->disabledPluginActions();
+    if (!loader)
+        return;
+
+    QDomNodeList actionList = elem.elementsByTagName(QString::fromLatin1("Action"));
     QDomElemList disabledElements;
 
     for(int i = 0; i < actionList.size(); ++i)
@@ -127,7 +393,7 @@ void Plugin::Private::XMLParser::removeDisabledActions(QDomElement& elem)
         if (el.isNull())
             continue;
 
-        if (disabledActions.contains(el.attribute(QString::fromLatin1("name"))))
+        if (loader->isActionDisabled(el.attribute(QString::fromLatin1("name"))))
         {
             disabledElements << el;
         }
@@ -141,31 +407,19 @@ void Plugin::Private::XMLParser::removeDisabledActions(QDomElement& elem)
     }
 }
 
-void Plugin::Private::XMLParser::buildPaths(const QDomElement& original, const QDomNodeList& localNodes,
-                                            QHashPath& paths, QDomElemList& stack)
+void Plugin::Private::XMLParser::buildHostIndex(const QDomElement& original, QHashPath& index, QDomElemList& stack)
 {
-    stack.push_back(original.cloneNode(true).toElement());
-
-    int idx;
+    // Elements are pushed as lightweight references to the host document nodes, which are never modified.
+    stack.push_back(original);
 
-    if ((idx = findByNameAttr(localNodes, original)) != -1)
-    {
-        paths[localNodes.item(idx).toElement().attribute(QString::fromLatin1("name"))] = stack;
-    }
-
-    if (!original.hasChildNodes())
-    {
-        stack.pop_back();
-        return;
-    }
+    index[nodeKey(original.tagName(), original.attribute(QString::fromLatin1("name")))] = stack;
 
-    for (QDomNode n = original.firstChild(); !n.isNull(); n = n.nextSibling())
+    for (QDomElement e = original.firstChildElement(QString::fromLatin1("Menu")); !e.isNull();
+         e = e.nextSiblingElement(QString::fromLatin1("Menu")))
     {
-        QDomElement e = n.toElement();
-
-        if (e.tagName() == QString::fromLatin1("Menu") && e.hasChildNodes())
+        if (e.hasChildNodes())
         {
-            buildPaths(e, localNodes, paths, stack);
+            buildHostIndex(e, index, stack);
         }
     }
 
@@ -189,13 +443,22 @@ QList<QAction *> Plugin::actions(QWidget* const widget) const
 {
     QWidget* const w = !widget ? d->defaultWidget : widget;
 
-    if (!d->actionsCat.contains(w))
+    const auto it    = d->actionsCat.constFind(w);
+
+    if (it == d->actionsCat.constEnd())
     {
         qCWarning(LIBKIPI_LOG) << "Error in plugin. It needs to call Plugin::setup(QWidget*) "
                                << "as the very first line when overriding the setup method.";
+
+        return QList<QAction*>();
     }
 
-    return d->actionsCat[w].keys();
+    return it->actions;
+}
+
+bool Plugin::isSetup(QWidget* const widget) const
+{
+    return (widget ? d->actionsCat.contains(widget) : !d->actionsCat.isEmpty());
 }
 
 void Plugin::addAction(const QString& name, QAction* const action)
@@ -203,7 +466,9 @@ void Plugin::addAction(const QString& name, QAction* const action)
     if (!action || name.isEmpty())
         return;
 
-    if (!PluginLoader::instance()->disabledPluginActions().contains(name))
+    const PluginLoader* const pluginLoader = loader();
+
+    if (!pluginLoader || !pluginLoader->isActionDisabled(name))
     {
         actionCollection()->addAction(name, action);
         addAction(action);
@@ -224,7 +489,9 @@ void Plugin::addAction(const QString& name, QAction* const action, Category cat)
     if (!action || name.isEmpty())
         return;
 
-    if (!PluginLoader::instance()->disabledPluginActions().contains(name))
+    const PluginLoader* const pluginLoader = loader();
+
+    if (!pluginLoader || !pluginLoader->isActionDisabled(name))
     {
         actionCollection()->addAction(name, action);
         addAction(action, cat);
@@ -244,34 +511,49 @@ void Plugin::addAction(QAction* const action, Category cat)
                                   "to use a valid Category";
     }
 
-    d->actionsCat[d->defaultWidget].insert(action, cat);
+    Private::WidgetActions& widgetActions = d->actionsCat[d->defaultWidget];
+
+    if (!widgetActions.categories.contains(action))
+    {
+        widgetActions.actions.append(action);
+    }
+
+    widgetActions.categories.insert(action, cat);
+
+    if (PluginLoader* const pluginLoader = loader())
+    {
+        pluginLoader->registerAction(this, action, cat);
+    }
 }
 
 void Plugin::setup(QWidget* const widget)
 {
     clearActions();
     d->defaultWidget = widget;
-    d->actionsCat.insert(widget, QMap<QAction*, Category>());
+    d->actionsCat.insert(widget, Private::WidgetActions());
 }
 
 Category Plugin::category(QAction* const action) const
 {
-    QMap<QAction *, Category>::const_iterator it = d->actionsCat[d->defaultWidget].constFind(action);
+    const auto wit = d->actionsCat.constFind(d->defaultWidget);
 
-    if (it != d->actionsCat[d->defaultWidget].constEnd())
-    {
-        return it.value();
-    }
-    else
+    if (wit != d->actionsCat.constEnd())
     {
-        if (d->defaultCategory == InvalidCategory)
+        const auto it = wit->categories.constFind(action);
+
+        if (it != wit->categories.constEnd())
         {
-            qCWarning(LIBKIPI_LOG) << "Error in plugin. Invalid category. "
-                                      "You must set default plugin category.";
+            return it.value();
         }
+    }
 
-        return d->defaultCategory;
+    if (d->defaultCategory == InvalidCategory)
+    {
+        qCWarning(LIBKIPI_LOG) << "Error in plugin. Invalid category. "
+                                  "You must set default plugin category.";
     }
+
+    return d->defaultCategory;
 }
 
 Interface* Plugin::interface() const
@@ -279,6 +561,13 @@ Interface* Plugin::interface() const
     return (dynamic_cast<Interface*>(parent()));
 }
 
+PluginLoader* Plugin::loader() const
+{
+    PluginLoader* const pluginLoader = PluginLoader::instanceFor(interface());
+
+    return (pluginLoader ? pluginLoader : PluginLoader::instance());
+}
+
 void Plugin::setUiBaseName(const char* name)
 {
     if (name && *name)
@@ -304,6 +593,8 @@ void Plugin::mergeXMLFile(KXMLGUIClient *const host)
         return;
     }
 
+    Profiler::Scope scope("Plugin::mergeXMLFile", this);
+
     const QString componentName = QApplication::applicationName();
     const QString defaultUI     = QStandardPaths::locate(QStandardPaths::GenericDataLocation, QString::fromLatin1("kxmlgui5/kipi/") + d->uiBaseName);
     const QString localUIdir    = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QString::fromLatin1("/kxmlgui5/") +
@@ -315,28 +606,57 @@ void Plugin::mergeXMLFile(KXMLGUIClient *const host)
     QFile        defaultUIFile(defaultUI);
     QDomDocument defaultDomDoc;
 
-    if (!defaultUIFile.open(QFile::ReadOnly) || !defaultDomDoc.setContent(&defaultUIFile))
+    if (!defaultUIFile.open(QFile::ReadOnly))
     {
         qCCritical(LIBKIPI_LOG) << "Could not open default ui file " << defaultUI << " for ui basename " << d->uiBaseName;
         return;
     }
 
+    const QByteArray defaultData  = defaultUIFile.readAll();
     defaultUIFile.close();
     const QDomDocument hostDoc    = host->domDocument();
 
-    if (hostDoc.isNull() || defaultDomDoc.isNull())
+    if (hostDoc.isNull())
     {
         qCCritical(LIBKIPI_LOG) << "Cannot merge the XML files, at least one is null!";
         return;
     }
 
+    // The merge only depends on the host document, on the default ui file and on the disabled actions.
+    // If they did not change since the local ui file was written, this one is used as is.
+
+    const PluginLoader* const pluginLoader = loader();
+    QStringList disabledActions            = pluginLoader ? pluginLoader->disabledPluginActions() : QStringList();
+    disabledActions.sort();
+
+    const QByteArray hostKey  = s_mergeCache->hostDocumentKey(hostDoc);
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(hostKey);
+    hash.addData(defaultData);
+    hash.addData(disabledActions.join(QLatin1Char('\n')).toUtf8());
+    const QByteArray mergeKey = hash.result();
+
+    if (s_mergeCache->isMerged(localUI, mergeKey))
+    {
+        qCDebug(LIBKIPI_LOG) << "UI file already merged :" << localUI;
+        setXMLFile(d->uiBaseName);
+        return;
+    }
+
+    if (!defaultDomDoc.setContent(defaultData) || defaultDomDoc.isNull())
+    {
+        qCCritical(LIBKIPI_LOG) << "Could not open default ui file " << defaultUI << " for ui basename " << d->uiBaseName;
+        return;
+    }
+
     QDomElement hostGuiElem       = hostDoc.firstChildElement(QString::fromLatin1("kpartgui"));
     QDomElement hostMenuBarElem   = hostGuiElem.firstChildElement(QString::fromLatin1("MenuBar"));
 
     QDomDocument newPluginDoc(defaultDomDoc.doctype());
     QDomElement  defGuiElem       = defaultDomDoc.firstChildElement(QString::fromLatin1("gui"));
 
-    Private::XMLParser::removeDisabledActions(defGuiElem);
+    Private::XMLParser::removeDisabledActions(pluginLoader, defGuiElem);
 
     QDomElement newGuiElem        = Private::XMLParser::makeElement(newPluginDoc, defGuiElem);
     QDomElement defMenuBarElem    = defGuiElem.firstChildElement(QString::fromLatin1("MenuBar"));
@@ -344,8 +664,18 @@ void Plugin::mergeXMLFile(KXMLGUIClient *const host)
     QDomElement defToolBarElem    = defGuiElem.firstChildElement(QString::fromLatin1("ToolBar"));
     QDomElement defActionPropElem = defGuiElem.firstChildElement(QString::fromLatin1("ActionProperties"));
 
+    // The host menus are indexed once while all plugins are merged, unless the host document changes.
+
+    QHashPath hostIndex;
+
+    if (!s_mergeCache->hostIndex(hostKey, hostIndex))
+    {
+        Private::XMLParser::buildHostIndex(hostMenuBarElem, hostIndex);
+        s_mergeCache->setHostIndex(hostKey, hostIndex);
+    }
+
     QHashPath paths;
-    Private::XMLParser::buildPaths(hostMenuBarElem, defMenuBarElem.childNodes(), paths);
+    Private::XMLParser::buildPaths(hostIndex, defMenuBarElem.childNodes(), paths);
 
     for (QDomNode n = defMenuBarElem.firstChild(); !n.isNull(); n = n.nextSibling())
     {
@@ -409,7 +739,7 @@ void Plugin::mergeXMLFile(KXMLGUIClient *const host)
     {
         QDomElement localGuiElem        = localDomDoc.firstChildElement(QString::fromLatin1("gui"));
 
-        Private::XMLParser::removeDisabledActions(localGuiElem);
+        Private::XMLParser::removeDisabledActions(pluginLoader, localGuiElem);
 
         QDomElement localToolBarElem    = localGuiElem.firstChildElement(QString::fromLatin1("ToolBar"));
         QDomElement localActionPropElem = localGuiElem.firstChildElement(QString::fromLatin1("ActionProperties"));
@@ -432,11 +762,18 @@ void Plugin::mergeXMLFile(KXMLGUIClient *const host)
     writeFile.write(newPluginDoc.toString().toUtf8());
     writeFile.close();
 
+    s_mergeCache->setMerged(localUI, mergeKey);
+
     setXMLFile(d->uiBaseName);
 }
 
 void Plugin::clearActions()
 {
+    if (PluginLoader* const pluginLoader = loader())
+    {
+        pluginLoader->unregisterActions(this);
+    }
+
     const QList<QAction*> actions = actionCollection()->actions();
 
     for (QAction* const action : actions)
@@ -461,6 +798,44 @@ void Plugin::rebuild()
     }
 }
 
+QStringList Plugin::operations() const
+{
+    return d->operations.keys();
+}
+
+bool Plugin::hasOperation(const QString& name) const
+{
+    return d->operations.contains(name);
+}
+
+QVariantMap Plugin::runOperation(const QString& name, const ImageCollection& images, const QVariantMap& options) const
+{
+    const Operation operation = d->operations.value(name);
+
+    if (!operation)
+    {
+        qCWarning(LIBKIPI_LOG) << "Plugin" << objectName() << "has no operation named" << name;
+        return QVariantMap();
+    }
+
+    if (Profiler::isEnabled())
+    {
+        Profiler::addImages(images.images(), objectName());
+    }
+
+    Profiler::Scope scope("Plugin::runOperation", this);
+
+    return operation(images, options);
+}
+
+void Plugin::addOperation(const QString& name, const Operation& operation)
+{
+    if (name.isEmpty() || !operation)
+        return;
+
+    d->operations.insert(name, operation);
+}
+
 void Plugin::setDefaultCategory(Category cat)
 {
     d->defaultCategory = cat;
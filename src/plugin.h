@@ -14,12 +14,15 @@
 // Std includes
 
 #include <memory>
+#include <functional>
 
 // Qt includes
 
 #include <QObject>
 #include <QList>
 #include <QHash>
+#include <QStringList>
+#include <QVariantMap>
 #include <QDomElement>
 #include <QDomNode>
 #include <QDomDocument>
@@ -38,6 +41,8 @@ namespace KIPI
 {
 
 class Interface;
+class PluginLoader;
+class ImageCollection;
 
 /**
  * The Category enum.
@@ -65,7 +70,14 @@ class LIBKIPI_EXPORT Plugin : public QObject, public KXMLGUIClient
 
     typedef QList<QDomElement>                        QDomElemList;
     typedef QHash<QString, QDomElemList>              QHashPath;
-    typedef QMap<QWidget*, QMap<QAction*, Category> > ActionCategoryMap;
+
+public:
+
+    /**
+     * A headless operation: processes the images of a collection with a set of options,
+     * and returns its results. See addOperation().
+     */
+    typedef std::function<QVariantMap (const ImageCollection&, const QVariantMap&)> Operation;
 
 public:
 
@@ -92,11 +104,21 @@ public:
      */
     QList<QAction*> actions(QWidget* const widget = nullptr) const;
 
+    /**
+     * Returns true if setup() has been called for @p widget, or for any widget if @p widget is a nullptr.
+     */
+    bool isSetup(QWidget* const widget = nullptr) const;
+
     /**
      * Returns the KIPI::Interface
      */
     Interface* interface() const;
 
+    /**
+     * Returns the KIPI::PluginLoader which hosts this plugin, found through its interface.
+     */
+    PluginLoader* loader() const;
+
     /**
      * Virtual method that must be overridden by the non abstract descendants and
      * must be called before any actions are added.
@@ -116,8 +138,40 @@ public:
      */
     void rebuild();
 
+    /**
+     * Returns the names of the headless operations registered with addOperation().
+     */
+    QStringList operations() const;
+
+    /**
+     * Returns true if an operation named @p name is registered.
+     */
+    bool hasOperation(const QString& name) const;
+
+    /**
+     * Run the operation named @p name on @p images, with @p options, and return its results.
+     * Unlike actions, operations do not need setup() to be called, nor a QApplication: they can
+     * be run under QCoreApplication, from any thread.
+     *
+     * An empty map is returned if the operation is not registered.
+     */
+    QVariantMap runOperation(const QString& name, const ImageCollection& images,
+                             const QVariantMap& options = QVariantMap()) const;
+
 protected:
 
+    /**
+     * Register a headless operation to the plugin instance. It must be called from the plugin
+     * constructor, as operations are looked up before setup() is called. The operation must also be
+     * listed in the X-KIPI-Operations entry of the plugin desktop file, for PluginLoader::operationPlugin()
+     * to find it without instantiating every plugin.
+     *
+     * @param name the unique name of the operation
+     * @param operation the function to run. As operations can be run concurrently by a host,
+     * the function must be reentrant and must not create widgets.
+     */
+    void addOperation(const QString& name, const Operation& operation);
+
     /**
      * Register an action to the plugin instance and add it to the action collection.
      *
@@ -13,20 +13,34 @@
 // Qt includes
 
 #include <QStringList>
+#include <QSet>
+#include <QHash>
 #include <QVariantList>
 #include <QVariant>
+#include <QVariantMap>
+#include <QJsonObject>
 #include <QAction>
+#include <QWidget>
 #include <QStandardPaths>
+#include <QCoreApplication>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QGlobalStatic>
 
 // KF includes
 
-#include <KServiceTypeTrader>
 #include <KSharedConfig>
 #include <KDesktopFile>
 #include <KConfigGroup>
 #include <KXMLGUIFactory>
 #include <KToolBar>
 #include <KActionCollection>
+#include <KPluginLoader>
+#include <KPluginFactory>
 
 // Local includes
 
@@ -36,6 +50,8 @@
 #include "libkipi_version.h"
 #include "libkipi_config.h"
 #include "libkipi_debug.h"
+#include "pluginmetadatacache.h"
+#include "profiler.h"
 
 namespace KIPI
 {
@@ -49,18 +65,165 @@ public:
         shouldLoad = false;
         plugin     = nullptr;
         parent     = nullptr;
+        preloading = false;
+        factory    = nullptr;
+        stubParent = nullptr;
+        stubsSetup = false;
+        loader     = nullptr;
     }
 
-    bool           shouldLoad;
-    KService::Ptr  service;
-    Plugin*        plugin;
-    KXmlGuiWindow* parent;
+    /** Return the loader which created this Info, or the first loader for an Info built by host.
+     */
+    PluginLoader* owner() const
+    {
+        return (loader ? loader : PluginLoader::instance());
+    }
+
+    /** Load the plugin library and resolve its factory in a background thread.
+     */
+    class PreloadTask : public QRunnable
+    {
+    public:
+
+        explicit PreloadTask(Private* const d)
+            : m_d(d)
+        {
+        }
+
+        void run() override
+        {
+            m_d->preload();
+        }
+
+    private:
+
+        Private* const m_d;
+    };
+
+    void            preload();
+    KPluginFactory* waitForPreload();
+    void            triggerStub(const Info* const info, const QString& name);
+
+public:
+
+    bool            shouldLoad;
+    PluginMetadata  metadata;
+
+    /// Created on demand from metadata when the Info is built from cache.
+    KService::Ptr   service;
+    Plugin*         plugin;
+    KXmlGuiWindow*  parent;
+
+    QMutex          preloadMutex;
+    QWaitCondition  preloadCondition;
+
+    /// True while a PreloadTask is pending for this plugin.
+    bool            preloading;
+
+    /// Factory resolved by preload(), living in the GUI thread.
+    KPluginFactory* factory;
+
+    /// Metadata of the preloaded library, passed to the plugin constructor as KService::createInstance() does.
+    QVariantMap     factoryMetaData;
+
+    /// Placeholders for actions declared in desktop file.
+    QList<QAction*> stubs;
+    QWidget*        stubParent;
+
+    /// True once triggerStub() made sure the plugin has been set up.
+    bool            stubsSetup;
+
+    PluginLoader*   loader;
 };
 
+void PluginLoader::Info::Private::preload()
+{
+    Profiler::Scope scope("PluginLoader::preload", metadata.uname);
+    KPluginLoader loader(metadata.library);
+    KPluginFactory* const pluginFactory = loader.factory();
+
+    if (pluginFactory)
+    {
+        // Plugin instance will be created in the GUI thread, as a child of the interface.
+
+        if (pluginFactory->thread() == QThread::currentThread())
+        {
+            pluginFactory->moveToThread(QCoreApplication::instance()->thread());
+        }
+
+        qCDebug(LIBKIPI_LOG) << "Preloaded plugin library " << metadata.library;
+    }
+    else
+    {
+        qCWarning(LIBKIPI_LOG) << "Cannot preload plugin library "
+                               << metadata.library
+                               << " with error: "
+                               << loader.errorString();
+    }
+
+    QMutexLocker lock(&preloadMutex);
+    factory         = pluginFactory;
+    factoryMetaData = loader.metaData().toVariantMap();
+    preloading      = false;
+    preloadCondition.wakeAll();
+}
+
+void PluginLoader::Info::Private::triggerStub(const Info* const info, const QString& name)
+{
+    Plugin* const instance = info->plugin();
+
+    if (!instance)
+    {
+        return;
+    }
+
+    // The host may have set the plugin up already: setting it up again would rebuild its actions.
+
+    if (!stubsSetup && !instance->isSetup())
+    {
+        instance->setup(stubParent);
+    }
+
+    stubsSetup = true;
+
+    QAction* const action = instance->actionCollection()->action(name);
+
+    if (!action)
+    {
+        qCWarning(LIBKIPI_LOG) << "Plugin " << metadata.name
+                               << " do not provide action " << name
+                               << " declared in its desktop file";
+        return;
+    }
+
+    action->trigger();
+}
+
+KPluginFactory* PluginLoader::Info::Private::waitForPreload()
+{
+    QMutexLocker lock(&preloadMutex);
+
+    while (preloading)
+    {
+        preloadCondition.wait(&preloadMutex);
+    }
+
+    return factory;
+}
+
 PluginLoader::Info::Info(KXmlGuiWindow* const parent, const KService::Ptr& service, bool shouldLoad)
     : d(new Private)
 {
     d->service    = service;
+    d->metadata   = PluginMetadata(service);
+    d->shouldLoad = shouldLoad;
+    d->parent     = parent;
+}
+
+PluginLoader::Info::Info(KXmlGuiWindow* const parent, const PluginMetadata& metadata, bool shouldLoad)
+    : d(new Private)
+{
+    d->metadata   = metadata;
     d->shouldLoad = shouldLoad;
     d->parent     = parent;
 }
@@ -78,42 +241,48 @@ PluginLoader::Info::~Info()
         }
     }
 
+    qDeleteAll(d->stubs);
     delete d->plugin;
 }
 
 KService::Ptr PluginLoader::Info::service() const
 {
+    if (!d->service)
+    {
+        d->service = d->metadata.createService();
+    }
+
     return d->service;
 }
 
 QString PluginLoader::Info::name() const
 {
-    return d->service->name();
+    return d->metadata.name;
 }
 
 QString PluginLoader::Info::uname() const
 {
-    return d->service->untranslatedGenericName();
+    return d->metadata.uname;
 }
 
 QString PluginLoader::Info::author()  const
 {
-    return d->service->property(QString::fromLatin1("author"), QVariant::String).toString();
+    return d->metadata.author;
 }
 
 QString PluginLoader::Info::comment() const
 {
-    return d->service->comment();
+    return d->metadata.comment;
 }
 
 QString PluginLoader::Info::library() const
 {
-    return d->service->library();
+    return d->metadata.library;
 }
 
 QIcon PluginLoader::Info::icon() const
 {
-    if (d->service->icon().isEmpty() && d->plugin)
+    if (d->metadata.icon.isEmpty() && d->plugin)
     {
         if (!d->plugin->actions().isEmpty() && d->plugin->actions().first())
         {
@@ -126,7 +295,7 @@ QIcon PluginLoader::Info::icon() const
     }
     else
     {
-        return QIcon::fromTheme(d->service->icon());
+        return QIcon::fromTheme(d->metadata.icon);
     }
 }
 
@@ -134,15 +303,28 @@ Plugin* PluginLoader::Info::plugin() const
 {
     if (!d->plugin && shouldLoad())
     {
+        Profiler::Scope scope("PluginLoader::Info::plugin", d->metadata.uname);
         QString error;
+        KPluginFactory* const factory = d->waitForPreload();
 
-        d->plugin = d->service->createInstance<Plugin>(PluginLoader::instance()->interface(), QVariantList(), &error);
+        if (factory)
+        {
+            // Same keyword and arguments as KService::createInstance(), used below without preloading.
+
+            d->plugin = factory->create<Plugin>(nullptr, d->owner()->interface(), d->metadata.keyword,
+                                                QVariantList() << d->factoryMetaData);
+        }
+
+        if (!d->plugin)
+        {
+            d->plugin = service()->createInstance<Plugin>(d->owner()->interface(), QVariantList(), &error);
+        }
 
         if (d->plugin)
         {
             qCDebug(LIBKIPI_LOG) << "Loaded plugin " << d->plugin->objectName();
 
-            Q_EMIT (PluginLoader::instance()->plug(const_cast<Info*>(this)));
+            Q_EMIT (d->owner()->plug(const_cast<Info*>(this)));
         }
         else
         {
@@ -159,7 +341,7 @@ Plugin* PluginLoader::Info::plugin() const
 
 QStringList PluginLoader::Info::pluginCategories() const
 {
-    return d->service->property(QString::fromLatin1("X-KIPI-PluginCategories")).toStringList();
+    return d->metadata.categories;
 }
 
 void PluginLoader::Info::reload()
@@ -176,7 +358,58 @@ void PluginLoader::Info::reload()
     }
 
     delete d->plugin;
-    d->plugin = nullptr;
+    d->plugin     = nullptr;
+    d->stubsSetup = false;
+}
+
+QList<QAction*> PluginLoader::Info::actionStubs(QWidget* const parent) const
+{
+    d->stubParent = parent;
+
+    if (!d->stubs.isEmpty() || d->metadata.actions.isEmpty())
+    {
+        return d->stubs;
+    }
+
+    const PluginLoader* const loader = d->owner();
+
+    for (const PluginActionMetadata& meta : std::as_const(d->metadata.actions))
+    {
+        if (loader->isActionDisabled(meta.name))
+        {
+            continue;
+        }
+
+        QAction* const stub = new QAction(QIcon::fromTheme(meta.icon), meta.text, nullptr);
+        stub->setObjectName(meta.name);
+
+        const QString name = meta.name;
+
+        QObject::connect(stub, &QAction::triggered,
+                         stub, [this, name]() { d->triggerStub(this, name); });
+
+        d->stubs << stub;
+    }
+
+    return d->stubs;
+}
+
+Category PluginLoader::Info::actionStubCategory(QAction* const stub) const
+{
+    if (!stub || !d->stubs.contains(stub))
+    {
+        return InvalidCategory;
+    }
+
+    for (const PluginActionMetadata& meta : std::as_const(d->metadata.actions))
+    {
+        if (meta.name == stub->objectName())
+        {
+            return meta.category;
+        }
+    }
+
+    return InvalidCategory;
 }
 
 bool PluginLoader::Info::shouldLoad() const
@@ -191,8 +424,32 @@ void PluginLoader::Info::setShouldLoad(bool value)
 
 //---------------------------------------------------------------------
 
-static PluginLoader* s_instance = nullptr;
-static bool          s_loaded   = false;
+/** All plugin loaders alive in the process, in creation order.
+ */
+class Q_DECL_HIDDEN PluginLoaderRegistry
+{
+public:
+
+    QMutex               mutex;
+    QList<PluginLoader*> loaders;
+};
+
+Q_GLOBAL_STATIC(PluginLoaderRegistry, s_registry)
+
+/** Client holding plugins as child clients, to add them all to a KXMLGUIFactory in a single call.
+ */
+class Q_DECL_HIDDEN PluginsGuiClient : public KXMLGUIClient
+{
+public:
+
+    PluginsGuiClient()
+    {
+        setXML(QString::fromLatin1("<!DOCTYPE gui SYSTEM \"kpartgui.dtd\">\n"
+                                   "<gui name=\"kipiplugins\" version=\"1\"/>"));
+    }
+};
+
+// -----------------------------------------------------------------------------------------------------------
 
 class Q_DECL_HIDDEN PluginLoader::Private
 {
@@ -200,31 +457,79 @@ public:
 
     Private()
     {
-        interface = nullptr;
-        parent    = nullptr;
+        interface         = nullptr;
+        parent            = nullptr;
+        loaded            = false;
+        preloadEnabled    = false;
+        incrementalReplug = false;
     }
 
-    QStringList              ignoredPlugins;
+    void registerLoader(PluginLoader* const loader)
+    {
+        QMutexLocker lock(&s_registry->mutex);
+        s_registry->loaders.append(loader);
+    }
+
+    QSet<QString>            ignoredPlugins;
     QStringList              disabledActions;
 
+    /// Same contents than disabledActions, for lookups.
+    QSet<QString>            disabledActionsSet;
+
     KXmlGuiWindow*           parent;
 
     PluginLoader::PluginList pluginList;
+    /// Protected by the registry mutex, as loaders are looked up by interface from any thread.
     Interface*               interface;
+
+    /// True once init() has been called.
+    bool                     loaded;
+    bool                     preloadEnabled;
+    bool                     incrementalReplug;
+
+    /// Threads used to load plugin libraries in background.
+    QThreadPool              preloadPool;
+
+    /// Parent client of the plugins added by plugAll().
+    std::unique_ptr<PluginsGuiClient> guiClient;
+
+    /// Index of the actions added by loaded plugins.
+    QHash<QString, QAction*>           actionsByName;
+    QHash<QAction*, QString>           actionNames;
+    QHash<int, QList<QAction*> >       actionsByCategory;
+    QHash<Plugin*, QList<QAction*> >   actionsByPlugin;
+
+public:
+
+    /** Remove @p action from the index, without using it, as it can be already deleted.
+     */
+    void forgetAction(QAction* const action)
+    {
+        const QString name = actionNames.take(action);
+        const auto it      = actionsByName.find(name);
+
+        if (it != actionsByName.end() && it.value() == action)
+        {
+            actionsByName.erase(it);
+        }
+
+        for (auto cit = actionsByCategory.begin(); cit != actionsByCategory.end(); ++cit)
+        {
+            cit->removeOne(action);
+        }
+    }
 };
 
 PluginLoader::PluginLoader()
     : d(new Private)
 {
-    Q_ASSERT((s_instance == nullptr) && (!s_loaded));
-    s_instance = this;
+    d->registerLoader(this);
 }
 
 PluginLoader::PluginLoader(KXmlGuiWindow* const parent)
     : d(new Private)
 {
-    Q_ASSERT((s_instance == nullptr) && (!s_loaded));
-    s_instance = this;
+    d->registerLoader(this);
 
     if (!parent)
     {
@@ -236,18 +541,30 @@ PluginLoader::PluginLoader(KXmlGuiWindow* const parent)
 
 void PluginLoader::setInterface(Interface* const interface)
 {
-    d->interface = interface;
+    {
+        // Read by instanceFor() from any thread.
+
+        QMutexLocker lock(&s_registry->mutex);
+        d->interface = interface;
+    }
+
     setParent(interface);
 }
 
 void PluginLoader::setIgnoredPluginsList(const QStringList& ignores)
 {
-    d->ignoredPlugins = ignores;
+    d->ignoredPlugins = QSet<QString>(ignores.constBegin(), ignores.constEnd());
+}
+
+bool PluginLoader::isPluginIgnored(const QString& uname) const
+{
+    return d->ignoredPlugins.contains(uname);
 }
 
 void PluginLoader::setDisabledPluginActions(const QStringList& disabledActions)
 {
-    d->disabledActions = disabledActions;
+    d->disabledActions    = disabledActions;
+    d->disabledActionsSet = QSet<QString>(disabledActions.constBegin(), disabledActions.constEnd());
 }
 
 QStringList PluginLoader::disabledPluginActions() const
@@ -255,29 +572,80 @@ QStringList PluginLoader::disabledPluginActions() const
     return d->disabledActions;
 }
 
+bool PluginLoader::isActionDisabled(const QString& name) const
+{
+    return d->disabledActionsSet.contains(name);
+}
+
+void PluginLoader::setPreloadPluginsEnabled(bool enabled)
+{
+    d->preloadEnabled = enabled;
+}
+
+bool PluginLoader::preloadPluginsEnabled() const
+{
+    return d->preloadEnabled;
+}
+
+void PluginLoader::setIncrementalReplugEnabled(bool enabled)
+{
+    d->incrementalReplug = enabled;
+}
+
+bool PluginLoader::incrementalReplugEnabled() const
+{
+    return d->incrementalReplug;
+}
+
+void PluginLoader::reloadPlugin(Info* const info)
+{
+    if (!info)
+    {
+        return;
+    }
+
+    if (info->d->plugin)
+    {
+        Q_EMIT unplug(info);
+    }
+
+    info->reload();
+
+    // Create the new instance, which emits plug().
+
+    if (info->shouldLoad())
+    {
+        info->plugin();
+    }
+}
+
 void PluginLoader::init()
 {
-    Q_ASSERT((s_instance != nullptr) && (!s_loaded));
+    Q_ASSERT(!d->loaded);
 
-    if (!d->interface)
+    Interface* const iface = interface();
+
+    if (!iface)
     {
         qWarning(LIBKIPI_LOG) << "KIPI host interface instance is null. No plugin will be loaded...";
         return;
     }
 
-    s_loaded                    = true;
-    const KService::List offers = KServiceTypeTrader::self()->query(QString::fromLatin1("KIPI/Plugin"));
-    KSharedConfigPtr config     = KSharedConfig::openConfig();
-    KConfigGroup group          = config->group(QString::fromLatin1("KIPI/EnabledPlugin"));
+    d->loaded = true;
+    Profiler::Scope scope("PluginLoader::init");
+
+    // Plugin properties are read from cache, to not query sycoca at each start.
+    const QList<PluginMetadata> plugins = PluginMetadataCache::plugins();
+    KSharedConfigPtr config             = KSharedConfig::openConfig();
+    KConfigGroup group                  = config->group(QString::fromLatin1("KIPI/EnabledPlugin"));
 
-    for (KService::List::ConstIterator iter = offers.begin(); iter != offers.end(); ++iter)
+    for (const PluginMetadata& meta : plugins)
     {
-        KService::Ptr service   = *iter;
-        QString name            = service->name();
-        QString uname           = service->untranslatedGenericName();
-        QString library         = service->library();
-        QStringList reqFeatures = service->property(QString::fromLatin1("X-KIPI-ReqFeatures")).toStringList();
-        int binVersion          = service->property(QString::fromLatin1("X-KIPI-BinaryVersion")).toInt();
+        const QString& name            = meta.name;
+        const QString& uname           = meta.uname;
+        const QString& library         = meta.library;
+        const QStringList& reqFeatures = meta.reqFeatures;
+        const int binVersion           = meta.binVersion;
 
         if (library.isEmpty() || uname.isEmpty())
         {
@@ -305,7 +673,7 @@ void PluginLoader::init()
         for (QStringList::const_iterator featureIt = reqFeatures.constBegin();
              featureIt != reqFeatures.constEnd(); ++featureIt)
         {
-            if (!d->interface->hasFeature(*featureIt))
+            if (!iface->hasFeature(*featureIt))
             {
                 qCDebug(LIBKIPI_LOG) << "Plugin " << name << " was not loaded because the host application is missing\n"
                                      << "the feature " << *featureIt;
@@ -321,12 +689,39 @@ void PluginLoader::init()
             continue;
         }
 
-        Info* const info = new Info(d->parent, service, load);
+        Info* const info = new Info(d->parent, meta, load);
+        info->d->loader  = this;
         d->pluginList.append(info);
     }
+
+    if (d->preloadEnabled)
+    {
+        int count = 0;
+
+        for (Info* const info : std::as_const(d->pluginList))
+        {
+            if (!info->shouldLoad())
+            {
+                continue;
+            }
+
+            info->d->preloading = true;
+            d->preloadPool.start(new Info::Private::PreloadTask(info->d.get()));
+            ++count;
+        }
+
+        qCDebug(LIBKIPI_LOG) << "Preloading" << count << "plugin libraries in background";
+    }
 }
 
-PluginLoader::~PluginLoader() = default;
+PluginLoader::~PluginLoader()
+{
+    if (!s_registry.isDestroyed())
+    {
+        QMutexLocker lock(&s_registry->mutex);
+        s_registry->loaders.removeOne(this);
+    }
+}
 
 void PluginLoader::loadPlugins()
 {
@@ -338,24 +733,215 @@ const PluginLoader::PluginList& PluginLoader::pluginList()
     return d->pluginList;
 }
 
+int PluginLoader::plugAll(KXMLGUIFactory* const factory)
+{
+    if (!factory)
+        return 0;
+
+    unplugAll();
+
+    if (!d->guiClient)
+    {
+        d->guiClient.reset(new PluginsGuiClient);
+    }
+
+    int count = 0;
+
+    for (Info* const info : std::as_const(d->pluginList))
+    {
+        if (!info->shouldLoad())
+            continue;
+
+        Plugin* const plugin = info->plugin();
+
+        if (!plugin)
+            continue;
+
+        // The plugin may have been added alone, by a plug() signal handler.
+        if (plugin->factory())
+        {
+            plugin->factory()->removeClient(plugin);
+        }
+
+        d->guiClient->insertChildClient(plugin);
+        ++count;
+    }
+
+    Profiler::Scope scope("PluginLoader::plugAll");
+
+    // The factory still merges the document of each plugin, but emits makingChanges() only once
+    // for the whole tree. The host window is not repainted until all plugins have been added.
+
+    QWidget* const window     = qobject_cast<QWidget*>(factory->parent());
+    const bool updatesEnabled = (window && window->updatesEnabled());
+
+    if (updatesEnabled)
+    {
+        window->setUpdatesEnabled(false);
+    }
+
+    factory->addClient(d->guiClient.get());
+
+    if (updatesEnabled)
+    {
+        window->setUpdatesEnabled(true);
+    }
+
+    qCDebug(LIBKIPI_LOG) << count << "plugins added to the gui factory";
+
+    return count;
+}
+
+void PluginLoader::unplugAll()
+{
+    if (!d->guiClient)
+        return;
+
+    if (d->guiClient->factory())
+    {
+        d->guiClient->factory()->removeClient(d->guiClient.get());
+    }
+
+    const QList<KXMLGUIClient*> children = d->guiClient->childClients();
+
+    for (KXMLGUIClient* const child : children)
+    {
+        d->guiClient->removeChildClient(child);
+    }
+}
+
+QAction* PluginLoader::action(const QString& name) const
+{
+    return d->actionsByName.value(name);
+}
+
+QList<QAction*> PluginLoader::actions(Category cat) const
+{
+    return d->actionsByCategory.value(cat);
+}
+
+void PluginLoader::registerAction(Plugin* const plugin, QAction* const action, Category cat)
+{
+    if (d->actionNames.contains(action))
+        return;
+
+    d->actionsByPlugin[plugin].append(action);
+    d->actionsByCategory[cat].append(action);
+    d->actionNames.insert(action, action->objectName());
+
+    if (!action->objectName().isEmpty())
+    {
+        d->actionsByName.insert(action->objectName(), action);
+    }
+
+    // Plugins can delete their actions by themselves.
+
+    connect(action, &QObject::destroyed,
+            this, [this, action]()
+            {
+                d->forgetAction(action);
+
+                for (auto it = d->actionsByPlugin.begin(); it != d->actionsByPlugin.end(); ++it)
+                {
+                    it->removeOne(action);
+                }
+            });
+}
+
+void PluginLoader::unregisterActions(Plugin* const plugin)
+{
+    const QList<QAction*> pluginActions = d->actionsByPlugin.take(plugin);
+
+    for (QAction* const action : pluginActions)
+    {
+        disconnect(action, &QObject::destroyed, this, nullptr);
+        d->forgetAction(action);
+    }
+}
+
+Plugin* PluginLoader::operationPlugin(const QString& name) const
+{
+    // Plugins already instantiated are looked up first, as it costs nothing.
+
+    for (Info* const info : std::as_const(d->pluginList))
+    {
+        if (info->shouldLoad() && info->d->plugin && info->d->plugin->hasOperation(name))
+        {
+            return info->d->plugin;
+        }
+    }
+
+    // Then only plugins which declare the operation in their desktop file are instantiated.
+
+    for (Info* const info : std::as_const(d->pluginList))
+    {
+        if (!info->shouldLoad() || info->d->plugin || !info->d->metadata.operations.contains(name))
+            continue;
+
+        Plugin* const plugin = info->plugin();
+
+        if (plugin && plugin->hasOperation(name))
+        {
+            return plugin;
+        }
+
+        qCWarning(LIBKIPI_LOG) << "Plugin " << info->d->metadata.name << " declares operation " << name
+                               << " but do not register it";
+    }
+
+    return nullptr;
+}
+
 PluginLoader* PluginLoader::instance()
 {
-    if (!s_instance)
+    QMutexLocker lock(&s_registry->mutex);
+
+    if (s_registry->loaders.isEmpty())
     {
         qCDebug(LIBKIPI_LOG) << "Instance is null...";
+        return nullptr;
+    }
+
+    return s_registry->loaders.first();
+}
+
+QList<PluginLoader*> PluginLoader::instances()
+{
+    QMutexLocker lock(&s_registry->mutex);
+
+    return s_registry->loaders;
+}
+
+PluginLoader* PluginLoader::instanceFor(const Interface* const iface)
+{
+    if (!iface)
+    {
+        return nullptr;
     }
 
-    return s_instance;
+    QMutexLocker lock(&s_registry->mutex);
+
+    for (PluginLoader* const loader : std::as_const(s_registry->loaders))
+    {
+        if (loader->d->interface == iface)
+        {
+            return loader;
+        }
+    }
+
+    return nullptr;
 }
 
 Interface* PluginLoader::interface() const
 {
+    QMutexLocker lock(&s_registry->mutex);
+
     return d->interface;
 }
 
 ConfigWidget* PluginLoader::configWidget(QWidget* const parent) const
 {
-    return new ConfigWidget(parent);
+    return new ConfigWidget(const_cast<PluginLoader*>(this), parent);
 }
 
 QString PluginLoader::kipiPluginsVersion() const
@@ -26,14 +26,18 @@
 
 // Local includes
 
+#include "plugin.h"
 #include "libkipi_export.h"
 
+class KXMLGUIFactory;
+
 namespace KIPI
 {
 
 class Plugin;
 class Interface;
 class ConfigWidget;
+class PluginMetadata;
 
 /**
     \author Gilles Caulier
@@ -41,8 +45,10 @@ class ConfigWidget;
     \class PluginLoader pluginloader.h <KIPI/PluginLoader>
     This is the class that will help host applications to load plugins.
     
-    This is a singleton and host applications should create the PluginLoader
-    just once, and then use the instance() static method to access it.
+    Host applications usually create the PluginLoader just once, and then use
+    the instance() static method to access it. Several loaders can also live in
+    the same process, each one with its own Interface, for example to run isolated
+    headless hosts; instanceFor() returns the loader which serves an interface.
 
     The host application must create an instance of the plugin loader, and
     call the method loadPlugins() to get the plugins loaded. To ensure that
@@ -203,10 +209,40 @@ public:
         bool shouldLoad() const;
         void setShouldLoad(bool);
 
+        /**
+         * Return placeholder actions for the actions declared in the plugin desktop file, built
+         * without loading the plugin. The plugin is loaded only when one of them is triggered:
+         * Plugin::setup() is then called with @p parent, and the plugin action with the same
+         * object name is triggered. Hosts can replace the placeholders by the real actions
+         * when the plug() signal is emitted.
+         *
+         * Actions are declared with an X-KIPI-Actions entry listing their names, and one
+         * [X-KIPI-Action <name>] group per action with Name, Icon and X-KIPI-Category entries.
+         * X-KIPI-Category is one of Images, Tools, Import, Export, Batch or Collections.
+         *
+         * An empty list is returned if the plugin do not declare its actions. Placeholders are
+         * owned by the Info instance.
+         */
+        QList<QAction*> actionStubs(QWidget* const parent) const;
+
+        /**
+         * Return the category declared for a placeholder returned by actionStubs().
+         */
+        Category actionStubCategory(QAction* const stub) const;
+
+    private:
+
+        /** Used by PluginLoader::init() with properties read from cache. The service
+         *  is created from the desktop file only when needed.
+         */
+        Info(KXmlGuiWindow* const parent, const PluginMetadata& metadata, bool shouldLoad);
+
     private:
 
         class Private;
         std::unique_ptr<Private> const d;
+
+        friend class PluginLoader;
     };
 
 public:
@@ -218,16 +254,14 @@ public:
     /**
      * Use this constructor if your application does not use KDE XML GUI technology.
      * 
-     * Note that the PluginLoader is intended to be a singleton, so you
-     * should create only one and then use instance().
+     * Note that the first PluginLoader created is returned by instance().
      */
     PluginLoader();
 
     /**
      * Standard constructor. You must pass the instance of KDE XML GUI application as argument.
      * 
-     * Note that the PluginLoader is intended to be a singleton, so you
-     * should create only one and then use instance().
+     * Note that the first PluginLoader created is returned by instance().
      * 
      * @param parent the pointer to the KXmlGuiWindow of your application
      */
@@ -236,8 +270,7 @@ public:
     /**
      * Standard destructor
      * 
-     * Since PluginLoader is a singleton, you should not call this
-     * in client code.
+     * Do not delete a PluginLoader as long as any of its plugins are in use.
      */
     ~PluginLoader() override;
 
@@ -256,6 +289,11 @@ public:
      */
     void setIgnoredPluginsList(const QStringList& ignores);
 
+    /**
+     * Return true if the plugin with untranslated name @p uname is in the ignore list.
+     */
+    bool isPluginIgnored(const QString& uname) const;
+
     /**
      * Set disabled plugin actions that will not be plugged into the gui,
      */
@@ -266,6 +304,36 @@ public:
      */
     QStringList disabledPluginActions() const;
 
+    /**
+     * Return true if the action named @p name is in the disabled plugin actions list.
+     * Prefer this method to a lookup in disabledPluginActions(), which copies the list.
+     */
+    bool isActionDisabled(const QString& name) const;
+
+    /**
+     * Enable loading of plugin libraries in background threads, right after init().
+     * Plugin instances are still created in the GUI thread by Info::plugin(), which only waits
+     * for the library if its loading is not yet complete. Call this method before init().
+     * Disabled by default.
+     */
+    void setPreloadPluginsEnabled(bool enabled);
+    bool preloadPluginsEnabled() const;
+
+    /**
+     * If enabled, ConfigWidget::apply() reloads only the plugins whose state changed with reloadPlugin(),
+     * instead of emitting replug(). Host application must then handle the plug() and unplug() signals.
+     * Disabled by default.
+     */
+    void setIncrementalReplugEnabled(bool enabled);
+    bool incrementalReplugEnabled() const;
+
+    /**
+     * Reload one plugin without touching the others: unplug() is emitted if the plugin is loaded,
+     * to let host application remove its actions, then the plugin instance is deleted. If the plugin
+     * should be loaded, a new instance is created and plug() is emitted.
+     */
+    void reloadPlugin(Info* const info);
+
     /**
      * Init plugin loader. Call this method to parse relevant plugins installed on your system.
      * Before to call this method, you must setup KIPI interface instance.
@@ -285,6 +353,20 @@ public:
      */
     const PluginList& pluginList();
 
+    /**
+     * Add all plugins which should be loaded to @p factory, as child clients of a single client.
+     * The factory still merges the gui of each plugin, but emits KXMLGUIFactory::makingChanges() only
+     * once instead of once per plugin, and the host window is not repainted while plugins are added.
+     * Plugins must be set up with Plugin::setup() before. Plugins instantiated by this call emit plug().
+     * Plugins added before are removed first. Return the number of plugins added.
+     */
+    int plugAll(KXMLGUIFactory* const factory);
+
+    /**
+     * Remove all plugins added by plugAll() from their gui factory.
+     */
+    void unplugAll();
+
     /**
      * Return the kipi-plugins version installed on your computer if it's found through kipiplugins.desktop file.
      */
@@ -296,18 +378,58 @@ public:
     ConfigWidget* configWidget(QWidget* const parent) const;
 
     /**
-     * Returns plugin loader instance.
+     * Return the action named @p name among the actions of loaded plugins, or a null pointer if there is none.
+     * Actions are indexed when plugins add them in Plugin::setup(), so the lookup is done in constant time.
+     */
+    QAction* action(const QString& name) const;
+
+    /**
+     * Return the actions of category @p cat among the actions of loaded plugins, in the order of addition.
+     */
+    QList<QAction*> actions(Category cat) const;
+
+    /**
+     * Return the plugin which provides the headless operation named @p name, or a null pointer
+     * if there is none. Among plugins which should be loaded, only the ones declaring the operation
+     * in their desktop file with an X-KIPI-Operations entry are instantiated to be looked up.
+     * See Plugin::runOperation().
+     */
+    Plugin* operationPlugin(const QString& name) const;
+
+    /**
+     * Returns the first plugin loader created in the process, or a null pointer if there is none.
      */
     static PluginLoader* instance();
 
+    /**
+     * Returns all plugin loaders alive in the process, in creation order. This method is thread-safe.
+     */
+    static QList<PluginLoader*> instances();
+
+    /**
+     * Returns the plugin loader which hosts plugins for @p iface, or a null pointer if there is none.
+     * This method is thread-safe.
+     */
+    static PluginLoader* instanceFor(const Interface* const iface);
+
 Q_SIGNALS:
 
+    /// Emitted when a plugin instance is created.
     void plug(KIPI::PluginLoader::Info*);
+
+    /// Emitted by reloadPlugin() before a plugin instance is deleted.
     void unplug(KIPI::PluginLoader::Info*);
 
     /// @note Plugin can be plugged through Info item.
     void replug();
 
+private:
+
+    /** Used by Plugin to index its actions.
+     */
+    void registerAction(Plugin* const plugin, QAction* const action, Category cat);
+    void unregisterActions(Plugin* const plugin);
+
 private:
 
     class Private;
@@ -316,6 +438,7 @@ private:
 private:
 
     friend class ConfigWidget;
+    friend class Plugin;
 };
 
 } // namespace KIPI
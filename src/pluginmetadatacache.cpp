@@ -0,0 +1,353 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "pluginmetadatacache.h"
+
+// Qt includes
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QLocale>
+#include <QPair>
+#include <QStandardPaths>
+#include <QVariant>
+
+// KF includes
+
+#include <KServiceTypeTrader>
+#include <KSycoca>
+#include <KDesktopFile>
+#include <KConfigGroup>
+
+// Local includes
+
+#include "libkipi_config.h"
+#include "libkipi_debug.h"
+
+namespace KIPI
+{
+
+/// Identify the cache file format. Increase version when the format change.
+static const quint32 s_cacheMagic   = 0x4B4D4443;
+static const quint32 s_cacheVersion = 6;
+
+typedef QList<QPair<QString, qint64> > DirList;
+
+/** Return the directories which host services and service types desktop files,
+ *  with their modification time. A plugin installed or removed changes this list.
+ */
+static DirList serviceDirs()
+{
+    DirList dirs;
+    const QStringList paths = QStandardPaths::locateAll(QStandardPaths::GenericDataLocation,
+                                                        QString::fromLatin1("kservices5"),
+                                                        QStandardPaths::LocateDirectory) +
+                              QStandardPaths::locateAll(QStandardPaths::GenericDataLocation,
+                                                        QString::fromLatin1("kservicetypes5"),
+                                                        QStandardPaths::LocateDirectory);
+
+    for (const QString& path : paths)
+    {
+        dirs << qMakePair(path, QFileInfo(path).lastModified().toMSecsSinceEpoch());
+    }
+
+    return dirs;
+}
+
+/** Return the files whose content is cached, with their modification time: the sycoca database,
+ *  rebuilt when any desktop file changes, and the desktop files of @p plugins, which can be edited
+ *  in place without changing the modification time of their directory.
+ */
+static DirList cachedFiles(const QList<PluginMetadata>& plugins)
+{
+    DirList files;
+    const QString sycoca = KSycoca::absoluteFilePath();
+
+    files << qMakePair(sycoca, QFileInfo(sycoca).lastModified().toMSecsSinceEpoch());
+
+    for (const PluginMetadata& meta : plugins)
+    {
+        files << qMakePair(meta.entryPath, QFileInfo(meta.entryPath).lastModified().toMSecsSinceEpoch());
+    }
+
+    return files;
+}
+
+/** Return true if none of @p files was modified since their time was recorded.
+ */
+static bool filesUpToDate(const DirList& files)
+{
+    for (const QPair<QString, qint64>& file : files)
+    {
+        if (QFileInfo(file.first).lastModified().toMSecsSinceEpoch() != file.second)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** Return the languages used to translate the desktop files: the locale name, and the languages of
+ *  the user interface, which the LANGUAGE environment variable can change without the locale.
+ */
+static QStringList cacheLanguages()
+{
+    return QStringList() << QLocale().name() << QLocale().uiLanguages()
+                         << qEnvironmentVariable("LANGUAGE").split(QLatin1Char(':'), Qt::SkipEmptyParts);
+}
+
+/** Return the category named @p name in a X-KIPI-Category entry.
+ */
+static Category categoryFromName(const QString& name)
+{
+    if      (name == QLatin1String("Images"))
+        return ImagesPlugin;
+    else if (name == QLatin1String("Tools"))
+        return ToolsPlugin;
+    else if (name == QLatin1String("Import"))
+        return ImportPlugin;
+    else if (name == QLatin1String("Export"))
+        return ExportPlugin;
+    else if (name == QLatin1String("Batch"))
+        return BatchPlugin;
+    else if (name == QLatin1String("Collections"))
+        return CollectionsPlugin;
+
+    return InvalidCategory;
+}
+
+QDataStream& operator<<(QDataStream& out, const PluginActionMetadata& action)
+{
+    return out << action.name << action.text << action.icon << qint32(action.category);
+}
+
+QDataStream& operator>>(QDataStream& in, PluginActionMetadata& action)
+{
+    qint32 category = InvalidCategory;
+    in >> action.name >> action.text >> action.icon >> category;
+    action.category = static_cast<Category>(category);
+
+    return in;
+}
+
+static QDataStream& operator<<(QDataStream& out, const PluginMetadata& meta)
+{
+    return out << meta.entryPath << meta.name    << meta.uname       << meta.library << meta.keyword
+               << meta.author    << meta.comment << meta.icon        << meta.reqFeatures
+               << meta.categories << qint32(meta.binVersion)         << meta.actions
+               << meta.operations;
+}
+
+static QDataStream& operator>>(QDataStream& in, PluginMetadata& meta)
+{
+    qint32 binVersion = 0;
+    in >> meta.entryPath >> meta.name    >> meta.uname       >> meta.library >> meta.keyword
+       >> meta.author    >> meta.comment >> meta.icon        >> meta.reqFeatures
+       >> meta.categories >> binVersion                       >> meta.actions
+       >> meta.operations;
+    meta.binVersion = binVersion;
+
+    return in;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+
+PluginActionMetadata::PluginActionMetadata()
+    : category(InvalidCategory)
+{
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+
+PluginMetadata::PluginMetadata()
+    : binVersion(0)
+{
+}
+
+PluginMetadata::PluginMetadata(const KService::Ptr& service)
+    : entryPath(service->entryPath()),
+      name(service->name()),
+      uname(service->untranslatedGenericName()),
+      library(service->library()),
+      keyword(service->pluginKeyword()),
+      author(service->property(QString::fromLatin1("author"), QVariant::String).toString()),
+      comment(service->comment()),
+      icon(service->icon()),
+      reqFeatures(service->property(QString::fromLatin1("X-KIPI-ReqFeatures")).toStringList()),
+      categories(service->property(QString::fromLatin1("X-KIPI-PluginCategories")).toStringList()),
+      binVersion(service->property(QString::fromLatin1("X-KIPI-BinaryVersion")).toInt()),
+      operations(service->property(QString::fromLatin1("X-KIPI-Operations")).toStringList())
+{
+    // Sycoca report paths relative to the services directory.
+
+    if (QDir::isRelativePath(entryPath))
+    {
+        entryPath = QStandardPaths::locate(QStandardPaths::GenericDataLocation,
+                                           QString::fromLatin1("kservices5/") + entryPath);
+    }
+
+    const QStringList actionNames = service->property(QString::fromLatin1("X-KIPI-Actions")).toStringList();
+
+    if (actionNames.isEmpty() || entryPath.isEmpty())
+    {
+        return;
+    }
+
+    // Action groups are not exposed by sycoca: read them from the desktop file.
+
+    KDesktopFile desktop(entryPath);
+
+    for (const QString& actionName : actionNames)
+    {
+        const KConfigGroup group = desktop.group(QString::fromLatin1("X-KIPI-Action ") + actionName);
+
+        if (!group.exists())
+        {
+            qCWarning(LIBKIPI_LOG) << "Plugin " << name << " do not describe its action " << actionName
+                                   << " in " << entryPath;
+            continue;
+        }
+
+        PluginActionMetadata action;
+        action.name     = actionName;
+        action.text     = group.readEntry("Name", QString());
+        action.icon     = group.readEntry("Icon", QString());
+        action.category = categoryFromName(group.readEntry("X-KIPI-Category", QString()));
+        actions << action;
+    }
+}
+
+KService::Ptr PluginMetadata::createService() const
+{
+    return KService::Ptr(new KService(entryPath));
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+
+QString PluginMetadataCache::cacheFile()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+           QLatin1String("/kipiplugins-metadata.cache");
+}
+
+QList<PluginMetadata> PluginMetadataCache::plugins()
+{
+    QList<PluginMetadata> list;
+
+    if (read(list))
+    {
+        qCDebug(LIBKIPI_LOG) << "Plugins metadata read from cache" << cacheFile();
+        return list;
+    }
+
+    list = query();
+    write(list);
+
+    return list;
+}
+
+QList<PluginMetadata> PluginMetadataCache::query()
+{
+    QList<PluginMetadata> list;
+    const KService::List offers = KServiceTypeTrader::self()->query(QString::fromLatin1("KIPI/Plugin"));
+    list.reserve(offers.size());
+
+    for (const KService::Ptr& service : offers)
+    {
+        list << PluginMetadata(service);
+    }
+
+    return list;
+}
+
+bool PluginMetadataCache::read(QList<PluginMetadata>& plugins)
+{
+    QFile file(cacheFile());
+
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0)
+    {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    quint32     magic      = 0;
+    quint32     version    = 0;
+    qint32      binVersion = 0;
+    QStringList languages;
+    DirList     dirs;
+    DirList     files;
+
+    in >> magic >> version;
+
+    bool valid = (magic == s_cacheMagic) && (version == s_cacheVersion);
+
+    if (valid)
+    {
+        in >> binVersion >> languages >> dirs >> files;
+
+        valid = (in.status()  == QDataStream::Ok)    &&
+                (binVersion   == kipi_binary_version) &&
+                (languages    == cacheLanguages())    &&
+                (dirs         == serviceDirs())       &&
+                filesUpToDate(files);
+    }
+
+    if (valid)
+    {
+        qint32 count = 0;
+        in >> count;
+
+        for (qint32 i = 0 ; (i < count) && (in.status() == QDataStream::Ok) ; ++i)
+        {
+            PluginMetadata meta;
+            in >> meta;
+            plugins << meta;
+        }
+
+        valid = (in.status() == QDataStream::Ok);
+    }
+
+    if (!valid)
+    {
+        plugins.clear();
+    }
+
+    return valid;
+}
+
+bool PluginMetadataCache::write(const QList<PluginMetadata>& plugins)
+{
+    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    QSaveFile file(cacheFile());
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qCWarning(LIBKIPI_LOG) << "Cannot write plugins metadata cache" << cacheFile();
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << s_cacheMagic << s_cacheVersion << qint32(kipi_binary_version) << cacheLanguages()
+        << serviceDirs()   << cachedFiles(plugins);
+    out << qint32(plugins.size());
+
+    for (const PluginMetadata& meta : plugins)
+    {
+        out << meta;
+    }
+
+    return file.commit();
+}
+
+} // namespace KIPI
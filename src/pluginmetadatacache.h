@@ -0,0 +1,121 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KIPI_PLUGINMETADATACACHE_H
+#define KIPI_PLUGINMETADATACACHE_H
+
+// Qt includes
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// KF includes
+
+#include <KService>
+
+// Local includes
+
+#include "plugin.h"
+
+namespace KIPI
+{
+
+/**
+ * Properties of a plugin action, declared in the plugin desktop file with an X-KIPI-Actions entry
+ * and one [X-KIPI-Action <name>] group per action.
+ */
+class PluginActionMetadata
+{
+public:
+
+    PluginActionMetadata();
+
+    /// Name of the action, as registered by the plugin with Plugin::addAction().
+    QString  name;
+    QString  text;
+    QString  icon;
+    Category category;
+};
+
+/**
+ * Properties of a plugin read from its desktop file, as needed by PluginLoader::init().
+ */
+class PluginMetadata
+{
+public:
+
+    PluginMetadata();
+
+    /** Read the properties from the @p service registered in sycoca.
+     */
+    explicit PluginMetadata(const KService::Ptr& service);
+
+    /** Return a service built from the desktop file, without querying sycoca.
+     */
+    KService::Ptr createService() const;
+
+public:
+
+    /// Absolute path of the desktop file.
+    QString     entryPath;
+
+    QString     name;
+    QString     uname;
+    QString     library;
+
+    /// Keyword of the plugin in its library, from X-KDE-PluginKeyword entry.
+    QString     keyword;
+    QString     author;
+    QString     comment;
+    QString     icon;
+    QStringList reqFeatures;
+    QStringList categories;
+    int         binVersion;
+
+    QList<PluginActionMetadata> actions;
+
+    /// Names of the headless operations registered by the plugin, from X-KIPI-Operations entry.
+    QStringList operations;
+};
+
+// ---------------------------------------------------------------------------------------------------------------
+
+/**
+ * Cache of the metadata of all installed plugins, to not query KServiceTypeTrader at each start of
+ * the host application.
+ *
+ * The cache is saved in the application cache directory. It is rebuilt when a directory which hosts
+ * services desktop files is modified, when a plugin desktop file or the sycoca database is modified,
+ * when the libkipi binary version changes, or when the locale or the user interface languages of the
+ * application change.
+ */
+class PluginMetadataCache
+{
+public:
+
+    /** Return the metadata of installed plugins, from the cache if it's up to date, or
+     *  from KServiceTypeTrader otherwise, in which case the cache is updated.
+     */
+    static QList<PluginMetadata> plugins();
+
+    /** Return the path of the cache file.
+     */
+    static QString cacheFile();
+
+private:
+
+    static bool read(QList<PluginMetadata>& plugins);
+    static bool write(const QList<PluginMetadata>& plugins);
+    static QList<PluginMetadata> query();
+
+    // Disable
+    PluginMetadataCache();
+};
+
+} // namespace KIPI
+
+#endif // KIPI_PLUGINMETADATACACHE_H
@@ -0,0 +1,549 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "pluginworker.h"
+
+// Std includes
+
+#include <cstring>
+
+// Qt includes
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDate>
+#include <QDeadlineTimer>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QProcess>
+#include <QSharedMemory>
+#include <QUrl>
+
+// Local includes
+
+#include "libkipi_debug.h"
+#include "imagecollection.h"
+#include "imagecollectionshared.h"
+#include "plugin.h"
+#include "pluginloader.h"
+#include "profiler.h"
+
+namespace KIPI
+{
+
+namespace
+{
+
+const char    s_workerArgument[] = "--kipi-worker";
+const quint32 s_magic            = 0x4b495057; // "KIPW"
+const int     s_sharedThreshold  = 64 * 1024;
+const int     s_connectTimeout   = 30000;
+const int     s_defaultTimeout   = 300000;
+
+QAtomicInt    s_counter;
+
+/** Return a name unique in the system for a socket or a shared memory segment.
+ */
+QString uniqueName()
+{
+    return QString::fromLatin1("kipi-worker-%1-%2").arg(QCoreApplication::applicationPid())
+                                                   .arg(s_counter.fetchAndAddRelaxed(1));
+}
+
+/** Frames are sent as their size followed by their data. Sending or receiving a frame fails if it
+ *  does not complete within @p timeout milliseconds, or -1 to wait forever.
+ */
+bool writeFrame(QLocalSocket* const socket, const QByteArray& frame, int timeout = -1)
+{
+    const QDeadlineTimer deadline(timeout);
+    QByteArray header;
+    QDataStream(&header, QIODevice::WriteOnly) << quint32(frame.size());
+
+    socket->write(header);
+    socket->write(frame);
+
+    while (socket->bytesToWrite() > 0)
+    {
+        if (!socket->waitForBytesWritten(int(deadline.remainingTime())))
+            return false;
+    }
+
+    return true;
+}
+
+bool readFrame(QLocalSocket* const socket, QByteArray& frame, int timeout = -1)
+{
+    const QDeadlineTimer deadline(timeout);
+
+    while (socket->bytesAvailable() < qint64(sizeof(quint32)))
+    {
+        if (!socket->waitForReadyRead(int(deadline.remainingTime())))
+            return false;
+    }
+
+    quint32 size = 0;
+    QDataStream(socket->read(sizeof(quint32))) >> size;
+
+    frame.clear();
+    frame.reserve(size);
+
+    while (quint32(frame.size()) < size)
+    {
+        if (socket->bytesAvailable() == 0 && !socket->waitForReadyRead(int(deadline.remainingTime())))
+            return false;
+
+        frame.append(socket->read(size - frame.size()));
+    }
+
+    return true;
+}
+
+/** Large payloads are copied once to a shared memory segment named @p key, which is kept by the sender in
+ *  @p segment until the next exchange, as the receiver has then read it for sure.
+ *  Return the number of bytes copied to the segment, or 0 if the payload is sent in the frame.
+ */
+qint64 writePayload(QDataStream& ds, const QVariantMap& map, std::unique_ptr<QSharedMemory>& segment,
+                    const QString& key)
+{
+    QByteArray payload;
+    QDataStream pds(&payload, QIODevice::WriteOnly);
+    pds.setVersion(QDataStream::Qt_5_15);
+    pds << map;
+
+    segment.reset();
+
+    if (payload.size() >= s_sharedThreshold)
+    {
+        segment.reset(new QSharedMemory(key));
+
+        if (segment->create(payload.size()))
+        {
+            segment->lock();
+            std::memcpy(segment->data(), payload.constData(), payload.size());
+            segment->unlock();
+
+            ds << true << segment->key() << qint64(payload.size());
+
+            return payload.size();
+        }
+
+        qCWarning(LIBKIPI_LOG) << "Cannot create shared memory segment:" << segment->errorString();
+        segment.reset();
+    }
+
+    ds << false << payload;
+
+    return 0;
+}
+
+/** Destroy the shared memory segment named @p key if no process is attached to it anymore. Segments are
+ *  System V ones under Unix: those of a worker which was killed would otherwise stay until reboot.
+ */
+void releaseSegment(const QString& key)
+{
+    QSharedMemory segment(key);
+
+    if (segment.attach(QSharedMemory::ReadOnly))
+    {
+        segment.detach();
+    }
+}
+
+/** Read a payload written by writePayload(). If @p sharedSize is not null, it is set to the number
+ *  of bytes read from a shared memory segment, or 0 if the payload was sent in the frame.
+ */
+bool readPayload(QDataStream& ds, QVariantMap& map, qint64* const sharedSize = nullptr)
+{
+    bool       shared = false;
+    QByteArray payload;
+    ds >> shared;
+
+    if (shared)
+    {
+        QString key;
+        qint64  size = 0;
+        ds >> key >> size;
+
+        QSharedMemory segment(key);
+
+        if (!segment.attach(QSharedMemory::ReadOnly) || segment.size() < size)
+        {
+            qCWarning(LIBKIPI_LOG) << "Cannot attach shared memory segment" << key << ":" << segment.errorString();
+            return false;
+        }
+
+        segment.lock();
+        payload = QByteArray(static_cast<const char*>(segment.constData()), int(size));
+        segment.unlock();
+        segment.detach();
+
+        if (sharedSize)
+            *sharedSize = size;
+    }
+    else
+    {
+        ds >> payload;
+    }
+
+    QDataStream pds(payload);
+    pds.setVersion(QDataStream::Qt_5_15);
+    pds >> map;
+
+    return (ds.status() == QDataStream::Ok && pds.status() == QDataStream::Ok);
+}
+
+/** Collection received by the worker process, with the properties read from the host collection.
+ */
+class Q_DECL_HIDDEN WorkerCollectionShared : public ImageCollectionShared
+{
+public:
+
+    QList<QUrl> images()      override { return m_images;      }
+    QString     name()        override { return m_name;        }
+    QString     comment()     override { return m_comment;     }
+    QString     category()    override { return m_category;    }
+    QDate       date()        override { return m_date;        }
+    QUrl        url()         override { return m_url;         }
+    bool        isDirectory() override { return m_isDirectory; }
+
+public:
+
+    QList<QUrl> m_images;
+    QString     m_name;
+    QString     m_comment;
+    QString     m_category;
+    QDate       m_date;
+    QUrl        m_url;
+    bool        m_isDirectory = false;
+};
+
+void writeCollection(QDataStream& ds, const ImageCollection& images)
+{
+    ds << images.isValid();
+
+    if (images.isValid())
+    {
+        ds << images.name() << images.comment() << images.category() << images.date()
+           << images.url()  << images.images()  << images.isDirectory();
+    }
+}
+
+ImageCollection readCollection(QDataStream& ds)
+{
+    bool valid = false;
+    ds >> valid;
+
+    if (!valid)
+        return ImageCollection();
+
+    WorkerCollectionShared* const shared = new WorkerCollectionShared;
+    ds >> shared->m_name   >> shared->m_comment >> shared->m_category >> shared->m_date
+       >> shared->m_url    >> shared->m_images  >> shared->m_isDirectory;
+
+    return ImageCollection(shared);
+}
+
+QVariantMap errorResults(const QString& error)
+{
+    QVariantMap results;
+    results.insert(QString::fromLatin1("error"), error);
+
+    return results;
+}
+
+} // namespace
+
+// --------------------------------------------------------------------------------------------------------------
+
+class Q_DECL_HIDDEN PluginWorker::Private
+{
+public:
+
+    Private() :
+        program(QCoreApplication::applicationFilePath()),
+        timeout(s_defaultTimeout),
+        socket(nullptr)
+    {
+    }
+
+    QString                        program;
+    QStringList                    arguments;
+    int                            timeout;
+
+    std::unique_ptr<QLocalServer>  server;
+    std::unique_ptr<QProcess>      process;
+    std::unique_ptr<QSharedMemory> segment;
+    QLocalSocket*                  socket;      // Owned by server.
+
+    /// Names given to the segments of the last replies, which the worker process can still hold.
+    QStringList                    replyKeys;
+};
+
+PluginWorker::PluginWorker(QObject* const parent)
+    : QObject(parent),
+      d(new Private)
+{
+}
+
+PluginWorker::~PluginWorker()
+{
+    stop();
+}
+
+void PluginWorker::setProgram(const QString& program, const QStringList& arguments)
+{
+    d->program   = program;
+    d->arguments = arguments;
+}
+
+void PluginWorker::setTimeout(int msecs)
+{
+    d->timeout = msecs;
+}
+
+int PluginWorker::timeout() const
+{
+    return d->timeout;
+}
+
+bool PluginWorker::isRunning() const
+{
+    return (d->process && d->process->state() == QProcess::Running &&
+            d->socket  && d->socket->state()  == QLocalSocket::ConnectedState);
+}
+
+bool PluginWorker::start()
+{
+    if (isRunning())
+        return true;
+
+    stop();
+
+    d->server.reset(new QLocalServer);
+    d->server->setSocketOptions(QLocalServer::UserAccessOption);
+
+    if (!d->server->listen(uniqueName()))
+    {
+        qCWarning(LIBKIPI_LOG) << "Cannot listen for plugin worker:" << d->server->errorString();
+        stop();
+        return false;
+    }
+
+    d->process.reset(new QProcess);
+    d->process->setProcessChannelMode(QProcess::ForwardedChannels);
+    d->process->start(d->program, QStringList(d->arguments) << QString::fromLatin1(s_workerArgument)
+                                                            << d->server->fullServerName());
+
+    if (!d->process->waitForStarted(s_connectTimeout) ||
+        !d->server->waitForNewConnection(s_connectTimeout))
+    {
+        qCWarning(LIBKIPI_LOG) << "Cannot start plugin worker" << d->program << ":" << d->process->errorString();
+        stop();
+        return false;
+    }
+
+    d->socket = d->server->nextPendingConnection();
+
+    qCDebug(LIBKIPI_LOG) << "Plugin worker started with pid" << d->process->processId();
+
+    return true;
+}
+
+void PluginWorker::stop()
+{
+    if (d->socket)
+    {
+        d->socket->disconnectFromServer();
+        d->socket = nullptr;
+    }
+
+    if (d->process && d->process->state() != QProcess::NotRunning)
+    {
+        // The worker exits when the socket is disconnected.
+
+        if (!d->process->waitForFinished(3000))
+        {
+            d->process->kill();
+            d->process->waitForFinished();
+        }
+    }
+
+    d->process.reset();
+    d->server.reset();
+    d->segment.reset();
+
+    // The worker process is gone: remove the segments it did not release.
+
+    for (const QString& key : std::as_const(d->replyKeys))
+    {
+        releaseSegment(key);
+    }
+
+    d->replyKeys.clear();
+}
+
+QVariantMap PluginWorker::runOperation(const QString& name, const ImageCollection& images, const QVariantMap& options)
+{
+    if (!start())
+    {
+        return errorResults(QString::fromLatin1("Cannot start plugin worker"));
+    }
+
+    QByteArray  request;
+    QDataStream ds(&request, QIODevice::WriteOnly);
+    ds.setVersion(QDataStream::Qt_5_15);
+    // The name of the segment of the reply is chosen here, to remove it if the worker dies before.
+
+    const QString replyKey = uniqueName();
+    d->replyKeys << replyKey;
+
+    while (d->replyKeys.size() > 2)
+    {
+        d->replyKeys.removeFirst();
+    }
+
+    ds << s_magic << name << replyKey;
+    writeCollection(ds, images);
+    const qint64 requestShared = writePayload(ds, options, d->segment, uniqueName());
+
+    Profiler::Scope scope("PluginWorker::runOperation");
+    QByteArray      reply;
+
+    if (!writeFrame(d->socket, request, d->timeout) || !readFrame(d->socket, reply, d->timeout))
+    {
+        const bool timedOut = (d->socket->error() == QLocalSocket::SocketTimeoutError);
+
+        if (timedOut)
+        {
+            // The worker is hung: do not wait for it to exit.
+
+            qCWarning(LIBKIPI_LOG) << "Plugin worker did not answer within" << d->timeout
+                                   << "ms while running operation" << name;
+            d->process->kill();
+        }
+        else
+        {
+            qCWarning(LIBKIPI_LOG) << "Plugin worker died while running operation" << name;
+        }
+
+        stop();
+
+        Q_EMIT crashed();
+
+        return errorResults(timedOut ? QString::fromLatin1("Plugin worker timed out")
+                                     : QString::fromLatin1("Plugin worker crashed"));
+    }
+
+    QDataStream rds(reply);
+    rds.setVersion(QDataStream::Qt_5_15);
+
+    quint32     magic = 0;
+    QString     error;
+    QString     plugin;
+    QVariantMap results;
+    qint64      replyShared = 0;
+    rds >> magic >> error >> plugin;
+
+    if (magic != s_magic || !readPayload(rds, results, &replyShared))
+    {
+        return errorResults(QString::fromLatin1("Invalid reply from plugin worker"));
+    }
+
+    // The counters of the worker process are not reported to the host: count the work here.
+
+    if (Profiler::isEnabled())
+    {
+        Profiler::addCount(QString::fromLatin1("worker bytes"), QString(),
+                           qint64(request.size()) + reply.size() + requestShared + replyShared);
+
+        if (!plugin.isEmpty())
+        {
+            Profiler::addImages(images.images(), plugin);
+        }
+    }
+
+    if (!error.isEmpty())
+    {
+        return errorResults(error);
+    }
+
+    return results;
+}
+
+bool PluginWorker::isWorkerProcess(const QStringList& arguments)
+{
+    return arguments.contains(QString::fromLatin1(s_workerArgument));
+}
+
+int PluginWorker::exec(PluginLoader* const loader)
+{
+    const QStringList arguments = QCoreApplication::arguments();
+    const QString serverName    = arguments.value(arguments.indexOf(QString::fromLatin1(s_workerArgument)) + 1);
+
+    QLocalSocket socket;
+    socket.connectToServer(serverName);
+
+    if (!socket.waitForConnected(s_connectTimeout))
+    {
+        qCWarning(LIBKIPI_LOG) << "Plugin worker cannot connect to" << serverName << ":" << socket.errorString();
+        return 1;
+    }
+
+    std::unique_ptr<QSharedMemory> segment;
+    QByteArray                     request;
+
+    while (readFrame(&socket, request))
+    {
+        QDataStream ds(request);
+        ds.setVersion(QDataStream::Qt_5_15);
+
+        quint32 magic = 0;
+        QString name;
+        QString replyKey;
+        ds >> magic >> name >> replyKey;
+
+        const ImageCollection images = readCollection(ds);
+        QVariantMap           options;
+        QVariantMap           results;
+        QString               error;
+        QString               pluginName;
+
+        if (magic != s_magic || !readPayload(ds, options))
+        {
+            error = QString::fromLatin1("Invalid request from host");
+        }
+        else
+        {
+            Plugin* const plugin = loader ? loader->operationPlugin(name) : nullptr;
+
+            if (plugin)
+            {
+                pluginName = plugin->objectName();
+                results    = plugin->runOperation(name, images, options);
+            }
+            else
+            {
+                error = QString::fromLatin1("No operation named %1").arg(name);
+            }
+        }
+
+        QByteArray  reply;
+        QDataStream rds(&reply, QIODevice::WriteOnly);
+        rds.setVersion(QDataStream::Qt_5_15);
+        rds << s_magic << error << pluginName;
+        writePayload(rds, results, segment, replyKey);
+
+        if (!writeFrame(&socket, reply))
+            break;
+    }
+
+    return 0;
+}
+
+} // namespace KIPI
+
+#include "moc_pluginworker.cpp"
@@ -0,0 +1,146 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KIPI_PLUGINWORKER_H
+#define KIPI_PLUGINWORKER_H
+
+// Std includes
+
+#include <memory>
+
+// Qt includes
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+// Local includes
+
+#include "libkipi_export.h"
+
+namespace KIPI
+{
+
+class ImageCollection;
+class PluginLoader;
+
+/** @class PluginWorker pluginworker.h <KIPI/PluginWorker>
+
+    Runs the headless operations of plugins (see Plugin::addOperation()) in a separate worker process,
+    so that a crashing or memory-hungry plugin does not take the host application down. Several
+    workers can be created to spread batch jobs over processes and cores.
+
+    The worker process is the host application itself, started again with a "--kipi-worker" argument.
+    Host application must handle it at the very beginning of its main() function, before creating any
+    widget:
+
+    \code
+
+    QCoreApplication app(argc, argv);
+
+    if (KIPI::PluginWorker::isWorkerProcess(app.arguments()))
+    {
+        MyKipiInterface    iface(&app);
+        KIPI::PluginLoader loader;
+        loader.setInterface(&iface);
+        loader.init();
+
+        return KIPI::PluginWorker::exec(&loader);
+    }
+
+    \endcode
+
+    Requests and results are exchanged with the worker through a local socket. Options and results
+    larger than 64 KiB, as image buffers, are passed through a shared memory segment instead. The
+    segments left by a worker process which crashed or was killed are removed when it is stopped.
+    Images themselves are not transferred: the worker process reads them from their URLs.
+
+    The worker process is started on first use, and started again after a crash. A PluginWorker must
+    be used from the thread where it was created.
+ */
+class LIBKIPI_EXPORT PluginWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit PluginWorker(QObject* const parent = nullptr);
+
+    /**
+     * Stops the worker process.
+     */
+    ~PluginWorker() override;
+
+    /**
+     * Set the program to start as worker process, and its arguments. By default, the host application
+     * is started again, without arguments. Call this method before start().
+     */
+    void setProgram(const QString& program, const QStringList& arguments = QStringList());
+
+    /**
+     * Set the time in milliseconds to wait for the worker process to receive a request and to answer it.
+     * When it is exceeded, the worker process is killed as if it crashed. Use -1 to wait forever.
+     * The default is 5 minutes.
+     */
+    void setTimeout(int msecs);
+
+    /**
+     * Return the time to wait for the worker process to answer a request, in milliseconds.
+     */
+    int timeout() const;
+
+    /**
+     * Start the worker process if it is not running, and wait until it is connected.
+     * Return false if the process could not be started.
+     */
+    bool start();
+
+    /**
+     * Stop the worker process. Pending operations are lost.
+     */
+    void stop();
+
+    /**
+     * Return true if the worker process is running and connected.
+     */
+    bool isRunning() const;
+
+    /**
+     * Run the operation named @p name in the worker process on @p images with @p options, and wait
+     * for its results. The worker process is started if needed.
+     *
+     * If the operation could not be run, for example because the worker process crashed or did not
+     * answer within timeout(), the returned map holds only an "error" entry with the reason.
+     */
+    QVariantMap runOperation(const QString& name, const ImageCollection& images,
+                             const QVariantMap& options = QVariantMap());
+
+    /**
+     * Return true if the process was started as a worker process, from its @p arguments.
+     */
+    static bool isWorkerProcess(const QStringList& arguments);
+
+    /**
+     * Run the worker loop: operations requested by the host are run with the plugins of @p loader,
+     * until the host disconnects. Return the exit code of the worker process.
+     */
+    static int exec(PluginLoader* const loader);
+
+Q_SIGNALS:
+
+    /// Emitted when the worker process died unexpectedly, or was killed as it did not answer in time.
+    void crashed();
+
+private:
+
+    class Private;
+    std::unique_ptr<Private> const d;
+};
+
+} // namespace KIPI
+
+#endif /* KIPI_PLUGINWORKER_H */
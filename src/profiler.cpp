@@ -0,0 +1,288 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "profiler.h"
+
+// Qt includes
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QGlobalStatic>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QObject>
+#include <QPair>
+#include <QThread>
+
+// Local includes
+
+#include "libkipi_startup_debug.h"
+
+namespace KIPI
+{
+
+/// 1 if enabled, 0 if disabled, -1 if the environment was not yet checked.
+static QBasicAtomicInt s_enabled = Q_BASIC_ATOMIC_INITIALIZER(-1);
+
+class Q_DECL_HIDDEN ProfilerData
+{
+public:
+
+    ProfilerData()
+    {
+        clock.start();
+    }
+
+    QElapsedTimer         clock;
+    QMutex                mutex;
+    QList<Profiler::Span> spans;
+
+    /// Counters values, by name and plugin.
+    QMap<QPair<QString, QString>, qint64> counters;
+
+    /// File where spans are written at exit, from KIPI_STARTUP_TRACE environment variable.
+    QString               traceFile;
+};
+
+Q_GLOBAL_STATIC(ProfilerData, s_data)
+
+static void saveTraceAtExit()
+{
+    if (!s_data.exists() || s_data->traceFile.isEmpty())
+    {
+        return;
+    }
+
+    Profiler::saveChromeTrace(s_data->traceFile);
+}
+
+/** Check KIPI_STARTUP_TRACE environment variable the first time profiler is used.
+ */
+static bool checkEnabled()
+{
+    const int enabled = s_enabled.loadAcquire();
+
+    if (enabled != -1)
+    {
+        return (enabled == 1);
+    }
+
+    const QString traceFile = qEnvironmentVariable("KIPI_STARTUP_TRACE");
+
+    if (traceFile.isEmpty())
+    {
+        s_enabled.testAndSetOrdered(-1, 0);
+    }
+    else if (s_enabled.testAndSetOrdered(-1, 1))
+    {
+        s_data->traceFile = traceFile;
+        qAddPostRoutine(saveTraceAtExit);
+    }
+
+    return (s_enabled.loadAcquire() == 1);
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+
+Profiler::Span::Span()
+    : start(0),
+      duration(0),
+      thread(0)
+{
+}
+
+Profiler::Counter::Counter()
+    : value(0)
+{
+}
+
+Profiler::Scope::Scope(const char* const phase, const QString& plugin)
+    : m_phase(phase),
+      m_object(nullptr),
+      m_start(Profiler::isEnabled() ? Profiler::now() : -1)
+{
+    if (m_start >= 0)
+    {
+        m_plugin = plugin;
+    }
+}
+
+Profiler::Scope::Scope(const char* const phase, const QObject* const object)
+    : m_phase(phase),
+      m_object(object),
+      m_start(Profiler::isEnabled() ? Profiler::now() : -1)
+{
+}
+
+Profiler::Scope::~Scope()
+{
+    if (m_start < 0)
+    {
+        return;
+    }
+
+    const qint64 duration = Profiler::now() - m_start;
+
+    Profiler::addSpan(QString::fromLatin1(m_phase), m_object ? m_object->objectName() : m_plugin,
+                      m_start, duration);
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+
+void Profiler::setEnabled(bool enabled)
+{
+    checkEnabled();
+    s_enabled.storeRelease(enabled ? 1 : 0);
+}
+
+bool Profiler::isEnabled()
+{
+    return checkEnabled();
+}
+
+qint64 Profiler::now()
+{
+    return s_data->clock.nsecsElapsed() / 1000;
+}
+
+void Profiler::addSpan(const QString& phase, const QString& plugin, qint64 start, qint64 duration)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    Span span;
+    span.phase    = phase;
+    span.plugin   = plugin;
+    span.start    = start;
+    span.duration = duration;
+    span.thread   = quintptr(QThread::currentThreadId());
+
+    qCDebug(LIBKIPI_STARTUP_LOG) << phase << plugin << "took" << double(duration) / 1000.0 << "ms";
+
+    QMutexLocker lock(&s_data->mutex);
+    s_data->spans.append(span);
+}
+
+void Profiler::addCount(const QString& name, const QString& plugin, qint64 value)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    QMutexLocker lock(&s_data->mutex);
+    s_data->counters[qMakePair(name, plugin)] += value;
+}
+
+void Profiler::addImages(const QList<QUrl>& urls, const QString& plugin)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    qint64 bytes = 0;
+
+    for (const QUrl& url : urls)
+    {
+        if (url.isLocalFile())
+        {
+            bytes += QFileInfo(url.toLocalFile()).size();
+        }
+    }
+
+    addCount(QString::fromLatin1("images"), plugin, urls.size());
+    addCount(QString::fromLatin1("bytes"),  plugin, bytes);
+}
+
+QList<Profiler::Span> Profiler::spans()
+{
+    QMutexLocker lock(&s_data->mutex);
+
+    return s_data->spans;
+}
+
+QList<Profiler::Counter> Profiler::counters()
+{
+    QMutexLocker lock(&s_data->mutex);
+    QList<Counter> list;
+
+    for (auto it = s_data->counters.constBegin() ; it != s_data->counters.constEnd() ; ++it)
+    {
+        Counter counter;
+        counter.name   = it.key().first;
+        counter.plugin = it.key().second;
+        counter.value  = it.value();
+        list.append(counter);
+    }
+
+    return list;
+}
+
+void Profiler::clear()
+{
+    QMutexLocker lock(&s_data->mutex);
+    s_data->spans.clear();
+    s_data->counters.clear();
+}
+
+QByteArray Profiler::toChromeTrace()
+{
+    const QList<Span> list = spans();
+    const qint64 pid       = QCoreApplication::applicationPid();
+    QJsonArray events;
+
+    for (const Span& span : list)
+    {
+        QJsonObject event;
+        event.insert(QLatin1String("name"), span.phase);
+        event.insert(QLatin1String("cat"),  QLatin1String("kipi"));
+        event.insert(QLatin1String("ph"),   QLatin1String("X"));
+        event.insert(QLatin1String("ts"),   double(span.start));
+        event.insert(QLatin1String("dur"),  double(span.duration));
+        event.insert(QLatin1String("pid"),  double(pid));
+        event.insert(QLatin1String("tid"),  double(span.thread));
+
+        if (!span.plugin.isEmpty())
+        {
+            QJsonObject args;
+            args.insert(QLatin1String("plugin"), span.plugin);
+            event.insert(QLatin1String("args"), args);
+        }
+
+        events.append(event);
+    }
+
+    QJsonObject trace;
+    trace.insert(QLatin1String("traceEvents"),     events);
+    trace.insert(QLatin1String("displayTimeUnit"), QLatin1String("ms"));
+
+    return QJsonDocument(trace).toJson(QJsonDocument::Compact);
+}
+
+bool Profiler::saveChromeTrace(const QString& filePath)
+{
+    QFile file(filePath);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qCWarning(LIBKIPI_STARTUP_LOG) << "Cannot write startup trace to" << filePath;
+        return false;
+    }
+
+    return (file.write(toChromeTrace()) != -1);
+}
+
+} // namespace KIPI
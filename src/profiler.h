@@ -0,0 +1,175 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KIPI_PROFILER_H
+#define KIPI_PROFILER_H
+
+// Qt includes
+
+#include <QList>
+#include <QString>
+#include <QByteArray>
+#include <QUrl>
+
+// Local includes
+
+#include "libkipi_export.h"
+
+class QObject;
+
+namespace KIPI
+{
+
+/** @class Profiler profiler.h <KIPI/Profiler>
+
+    Records the time spent in each phase of plugins loading: PluginLoader::init(), creation of plugin
+    instances by PluginLoader::Info::plugin(), Plugin::mergeXMLFile(), and any phase measured by the
+    host application with a Profiler::Scope, as Plugin::setup() or KXMLGUIFactory::addClient().
+
+    Profiling is disabled by default. It is enabled with setEnabled(), or by setting the
+    KIPI_STARTUP_TRACE environment variable to the path of a file where the spans are written in
+    Chrome trace format when the application exits. When disabled, a Scope costs one atomic read.
+
+    Each span is also reported through the kipi.library.startup logging category.
+
+    Besides spans, the profiler sums counters as the number of images given to Plugin::runOperation()
+    and the bytes they hold, or any quantity reported by the host application with addCount().
+ */
+class LIBKIPI_EXPORT Profiler
+{
+
+public:
+
+    /**
+     * A measured phase.
+     */
+    class LIBKIPI_EXPORT Span
+    {
+    public:
+
+        Span();
+
+    public:
+
+        QString   phase;
+
+        /// Name of the plugin concerned, or an empty string for a global phase.
+        QString   plugin;
+
+        /// Start time, in microseconds since the profiler was first used.
+        qint64    start;
+        qint64    duration;
+
+        /// Identifier of the thread where the phase ran.
+        quintptr  thread;
+    };
+
+    /**
+     * A quantity summed over the profiling session.
+     */
+    class LIBKIPI_EXPORT Counter
+    {
+    public:
+
+        Counter();
+
+    public:
+
+        QString   name;
+
+        /// Name of the plugin concerned, or an empty string for a global counter.
+        QString   plugin;
+
+        qint64    value;
+    };
+
+    /**
+     * Measures the time elapsed between its construction and destruction.
+     * Create it on the stack at the beginning of the phase to measure.
+     *
+     * Pass an existing string as @p plugin, as a plugin name built for the call costs even when
+     * the profiler is disabled. With @p object, the name is its objectName(), only read when the
+     * span is recorded.
+     */
+    class LIBKIPI_EXPORT Scope
+    {
+    public:
+
+        explicit Scope(const char* const phase, const QString& plugin = QString());
+        Scope(const char* const phase, const QObject* const object);
+        ~Scope();
+
+    private:
+
+        // Disable
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+
+    private:
+
+        const char* const    m_phase;
+        const QObject* const m_object;
+        QString              m_plugin;
+        const qint64         m_start;
+    };
+
+public:
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    /**
+     * Returns the current time, in microseconds since the profiler was first used.
+     */
+    static qint64 now();
+
+    /**
+     * Records a span measured by the caller. Nothing is done if the profiler is disabled.
+     */
+    static void addSpan(const QString& phase, const QString& plugin, qint64 start, qint64 duration);
+
+    /**
+     * Adds @p value to the counter @p name of @p plugin. Nothing is done if the profiler is disabled.
+     */
+    static void addCount(const QString& name, const QString& plugin, qint64 value);
+
+    /**
+     * Adds the number of @p urls and the size of the local files they point to, to the "images" and
+     * "bytes" counters of @p plugin. Nothing is done if the profiler is disabled.
+     */
+    static void addImages(const QList<QUrl>& urls, const QString& plugin);
+
+    /**
+     * Returns the spans recorded so far, in the order they were completed.
+     */
+    static QList<Span>    spans();
+
+    /**
+     * Returns the counters, sorted by name and plugin.
+     */
+    static QList<Counter> counters();
+
+    /**
+     * Forgets spans and counters.
+     */
+    static void           clear();
+
+    /**
+     * Returns the spans in the Chrome trace event format, to be loaded in chrome://tracing
+     * or any compatible viewer.
+     */
+    static QByteArray toChromeTrace();
+    static bool       saveChromeTrace(const QString& filePath);
+
+private:
+
+    // Disable
+    Profiler();
+};
+
+} // namespace KIPI
+
+#endif // KIPI_PROFILER_H
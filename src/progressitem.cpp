@@ -0,0 +1,294 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "progressitem.h"
+
+// Qt includes
+
+#include <QAtomicInteger>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPixmap>
+#include <QPointer>
+#include <QTimer>
+
+// Local includes
+
+#include "interface.h"
+
+namespace KIPI
+{
+
+class Q_DECL_HIDDEN ProgressItem::Private
+{
+public:
+
+    Private()
+        : parent(nullptr),
+          weight(1),
+          total(0),
+          completed(0),
+          done(0),
+          canceled(0),
+          statusChanged(0),
+          thumbChanged(0),
+          reported(false),
+          lastPercent(-1)
+    {
+    }
+
+    ~Private()
+    {
+        qDeleteAll(children);
+    }
+
+    double fraction() const
+    {
+        if (done.loadAcquire())
+            return 1.0;
+
+        const qint64 count = total.loadRelaxed();
+
+        if (count <= 0)
+            return 0.0;
+
+        double units = double(completed.loadRelaxed());
+
+        {
+            QMutexLocker lock(&mutex);
+
+            for (ProgressItem* const child : children)
+            {
+                units += double(child->d->weight) * child->d->fraction();
+            }
+        }
+
+        return qBound(0.0, units / double(count), 1.0);
+    }
+
+    bool isCanceled() const
+    {
+        return (canceled.loadRelaxed() || (parent && parent->isCanceled()));
+    }
+
+    /** Forward the changes since the last sampling to the host. Called in the thread of the item.
+     */
+    void sample()
+    {
+        if (reported || !iface)
+            return;
+
+        const bool  finished = done.loadAcquire();
+        const float percent  = float(qRound(fraction() * 1000.0)) / 10.0F;
+
+        if (percent != lastPercent)
+        {
+            lastPercent = percent;
+            iface->progressValueChanged(id, percent);
+        }
+
+        if (statusChanged.fetchAndStoreAcquire(0))
+        {
+            QString text;
+
+            {
+                QMutexLocker lock(&mutex);
+                text = status;
+            }
+
+            iface->progressStatusChanged(id, text);
+        }
+
+        if (thumbChanged.fetchAndStoreAcquire(0))
+        {
+            QImage image;
+
+            {
+                QMutexLocker lock(&mutex);
+                image = thumb;
+            }
+
+            iface->progressThumbnailChanged(id, QPixmap::fromImage(image));
+        }
+
+        if (finished)
+        {
+            reported = true;
+            timer.stop();
+            iface->progressCompleted(id);
+        }
+    }
+
+public:
+
+    QPointer<Interface>     iface;
+    QString                 id;
+
+    /// Item of which this item is a child task, and number of items of the parent it represents.
+    Private*                parent;
+    qint64                  weight;
+
+    QAtomicInteger<qint64>  total;
+    QAtomicInteger<qint64>  completed;
+    QAtomicInt              done;
+    QAtomicInt              canceled;
+    QAtomicInt              statusChanged;
+    QAtomicInt              thumbChanged;
+
+    /// Protects status, thumb and children.
+    mutable QMutex          mutex;
+    QString                 status;
+    QImage                  thumb;
+    QList<ProgressItem*>    children;
+
+    /// Sampling state, only used in the thread of the item.
+    QTimer                  timer;
+    bool                    reported;
+    float                   lastPercent;
+};
+
+ProgressItem::ProgressItem(Interface* const iface, const QString& title, bool canBeCanceled,
+                           bool hasThumb, QObject* const parent)
+    : QObject(parent),
+      d(new Private)
+{
+    if (!iface || !iface->hasFeature(HostSupportsProgressBar))
+    {
+        d->reported = true;
+        return;
+    }
+
+    d->iface = iface;
+    d->id    = iface->progressScheduled(title, canBeCanceled, hasThumb);
+
+    if (canBeCanceled)
+    {
+        connect(iface, &Interface::progressCanceled,
+                this, [this](const QString& progressId)
+            {
+                if (progressId == d->id && d->canceled.testAndSetRelaxed(0, 1))
+                {
+                    Q_EMIT canceled();
+                }
+            }
+        );
+    }
+
+    d->timer.setInterval(100);
+    connect(&d->timer, &QTimer::timeout,
+            this, [this]() { d->sample(); });
+
+    d->timer.start();
+}
+
+ProgressItem::ProgressItem(ProgressItem* const parentItem, qint64 total, qint64 weight)
+    : QObject(nullptr),
+      d(new Private)
+{
+    d->parent   = parentItem->d.get();
+    d->weight   = weight;
+    d->reported = true;
+    d->total.storeRelaxed(total);
+}
+
+ProgressItem::~ProgressItem()
+{
+    if (!d->reported)
+    {
+        complete();
+        d->sample();
+    }
+}
+
+QString ProgressItem::id() const
+{
+    return d->id;
+}
+
+void ProgressItem::setTotal(qint64 total)
+{
+    d->total.storeRelaxed(total);
+}
+
+qint64 ProgressItem::total() const
+{
+    return d->total.loadRelaxed();
+}
+
+void ProgressItem::advance(qint64 count)
+{
+    d->completed.fetchAndAddRelaxed(count);
+}
+
+qint64 ProgressItem::completed() const
+{
+    return d->completed.loadRelaxed();
+}
+
+double ProgressItem::fraction() const
+{
+    return d->fraction();
+}
+
+void ProgressItem::setStatus(const QString& status)
+{
+    {
+        QMutexLocker lock(&d->mutex);
+        d->status = status;
+    }
+
+    d->statusChanged.storeRelease(1);
+}
+
+void ProgressItem::setThumbnail(const QImage& thumb)
+{
+    {
+        QMutexLocker lock(&d->mutex);
+        d->thumb = thumb;
+    }
+
+    d->thumbChanged.storeRelease(1);
+}
+
+ProgressItem* ProgressItem::createChild(qint64 total, qint64 weight)
+{
+    ProgressItem* const child = new ProgressItem(this, total, weight);
+
+    QMutexLocker lock(&d->mutex);
+    d->children.append(child);
+
+    return child;
+}
+
+void ProgressItem::complete()
+{
+    d->done.storeRelease(1);
+}
+
+bool ProgressItem::isCompleted() const
+{
+    return d->done.loadAcquire();
+}
+
+bool ProgressItem::isCanceled() const
+{
+    return d->isCanceled();
+}
+
+void ProgressItem::setUpdateInterval(int msecs)
+{
+    d->timer.setInterval(msecs);
+}
+
+int ProgressItem::updateInterval() const
+{
+    return d->timer.interval();
+}
+
+} // namespace KIPI
+
+#include "moc_progressitem.cpp"
@@ -0,0 +1,164 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KIPI_PROGRESSITEM_H
+#define KIPI_PROGRESSITEM_H
+
+// Std includes
+
+#include <memory>
+
+// Qt includes
+
+#include <QObject>
+#include <QString>
+#include <QImage>
+
+// Local includes
+
+#include "libkipi_export.h"
+
+namespace KIPI
+{
+
+class Interface;
+
+/** @class ProgressItem progressitem.h <KIPI/ProgressItem>
+
+    Reports the progress of a plugin task to the progress manager of the host application, see
+    Interface::progressScheduled().
+
+    Counters are atomic and can be updated from any thread: advancing the task by one item is a single
+    atomic increment. The item is sampled at a fixed rate, 10 times per second by default, and only
+    changes are forwarded to the Interface::progressValueChanged(), Interface::progressStatusChanged()
+    and Interface::progressThumbnailChanged() methods of the host, from the thread where the item was
+    created. A plugin processing thousands of images does not flood the host with calls anymore.
+
+    \code
+
+    KIPI::ProgressItem progress(iface, i18n("Converting images"), true);
+    progress.setTotal(urls.count());
+
+    // In worker threads
+
+    for (const QUrl& url : urls)
+    {
+        if (progress.isCanceled())
+            return;
+
+        convert(url);
+        progress.advance();
+    }
+
+    // When done
+
+    progress.complete();
+
+    \endcode
+
+    A task can be split in child tasks with createChild(). The progress of a child is reported in its
+    parent, as a part of the items of the parent, and is not shown as a separate entry in the host.
+
+    If the host application does not support HostSupportsProgressBar feature, nothing is reported.
+ */
+class LIBKIPI_EXPORT ProgressItem : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * Schedule a new entry named @p title in the progress manager of the host application, with
+     * Interface::progressScheduled(). The item must be created in the thread of @p iface, usually
+     * the GUI thread, where the host is called.
+     */
+    ProgressItem(Interface* const iface, const QString& title, bool canBeCanceled = false,
+                 bool hasThumb = false, QObject* const parent = nullptr);
+
+    /**
+     * Complete the entry in the host application if it was not done yet. Child tasks are deleted.
+     */
+    ~ProgressItem() override;
+
+    /**
+     * Return the identifier of the entry in the host application, or a null string for a child task
+     * or if the host has no progress manager.
+     */
+    QString id() const;
+
+    /**
+     * Set the number of items to process. Can be called from any thread.
+     */
+    void   setTotal(qint64 total);
+    qint64 total() const;
+
+    /**
+     * Advance the task by @p count items. Can be called from any thread.
+     */
+    void   advance(qint64 count = 1);
+    qint64 completed() const;
+
+    /**
+     * Return the fraction of the task already done, from 0.0 to 1.0, including the progress of child tasks.
+     */
+    double fraction() const;
+
+    /**
+     * Set the description shown for the entry in the host. Only the last status set between two
+     * samplings is forwarded. Can be called from any thread.
+     */
+    void setStatus(const QString& status);
+
+    /**
+     * Set the thumbnail shown for the entry in the host, if it was scheduled with a thumbnail.
+     * An image is used as pixmaps cannot be created outside the GUI thread. Can be called from any thread.
+     */
+    void setThumbnail(const QImage& thumb);
+
+    /**
+     * Create a child task of @p total items, representing @p weight items of this task. The child is
+     * owned by this item and remains valid until this item is deleted. Can be called from any thread.
+     */
+    ProgressItem* createChild(qint64 total, qint64 weight = 1);
+
+    /**
+     * Mark the task as done. For the top level item, the entry is completed in the host application at
+     * the next sampling. Can be called from any thread.
+     */
+    void complete();
+    bool isCompleted() const;
+
+    /**
+     * Return true if the entry was canceled from the host application, for this item or a parent.
+     * Can be called from any thread.
+     */
+    bool isCanceled() const;
+
+    /**
+     * Set the interval between two samplings, in milliseconds. The default is 100 ms.
+     */
+    void setUpdateInterval(int msecs);
+    int  updateInterval() const;
+
+Q_SIGNALS:
+
+    /// Emitted when the entry is canceled from the host application.
+    void canceled();
+
+private:
+
+    /// Child task, see createChild().
+    ProgressItem(ProgressItem* const parentItem, qint64 total, qint64 weight);
+
+private:
+
+    class Private;
+    std::unique_ptr<Private> const d;
+};
+
+} // namespace KIPI
+
+#endif /* KIPI_PROGRESSITEM_H */
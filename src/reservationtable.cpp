@@ -0,0 +1,354 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "reservationtable.h"
+
+// Qt includes
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QSet>
+#include <QVector>
+
+namespace KIPI
+{
+
+namespace
+{
+
+const int s_shardCount = 16;
+
+/** Items are compared without redundant path segments and trailing slash.
+ */
+QUrl reservationKey(const QUrl& url)
+{
+    return url.adjusted(QUrl::NormalizePathSegments | QUrl::StripTrailingSlash);
+}
+
+} // namespace
+
+class Q_DECL_HIDDEN ReservationTable::Private
+{
+public:
+
+    class Reservation
+    {
+    public:
+
+        QObject* holder = nullptr;
+        QString  description;
+    };
+
+    class Shard
+    {
+    public:
+
+        mutable QMutex           mutex;
+        QHash<QUrl, Reservation> items;
+    };
+
+public:
+
+    int shardIndex(const QUrl& key) const
+    {
+        return int(qHash(key) % s_shardCount);
+    }
+
+    /** Split @p urls by shard, as keys with their position in @p urls.
+     */
+    QVector<QVector<QPair<QUrl, int> > > split(const QList<QUrl>& urls) const
+    {
+        QVector<QVector<QPair<QUrl, int> > > batches(s_shardCount);
+
+        for (int i = 0 ; i < urls.size() ; ++i)
+        {
+            const QUrl key = reservationKey(urls.at(i));
+            batches[shardIndex(key)].append(qMakePair(key, i));
+        }
+
+        return batches;
+    }
+
+    /** Return the items of @p urls whose position is set in @p selected.
+     */
+    static QList<QUrl> pick(const QList<QUrl>& urls, const QVector<bool>& selected)
+    {
+        QList<QUrl> list;
+
+        for (int i = 0 ; i < urls.size() ; ++i)
+        {
+            if (selected.at(i))
+                list.append(urls.at(i));
+        }
+
+        return list;
+    }
+
+    /** Reserve @p urls for @p reservingObject and return the items reserved, without emitting any signal.
+     */
+    QList<QUrl> reserve(ReservationTable* const q, const QList<QUrl>& urls, QObject* const reservingObject,
+                        const QString& descriptionOfAction)
+    {
+        if (!reservingObject || urls.isEmpty())
+            return QList<QUrl>();
+
+        const QVector<QVector<QPair<QUrl, int> > > batches = split(urls);
+        QVector<bool> done(urls.size(), false);
+        bool any = false;
+
+        for (int s = 0 ; s < s_shardCount ; ++s)
+        {
+            if (batches.at(s).isEmpty())
+                continue;
+
+            Shard& shard = shards[s];
+            QMutexLocker lock(&shard.mutex);
+
+            for (const QPair<QUrl, int>& item : batches.at(s))
+            {
+                Reservation& reservation = shard.items[item.first];
+
+                if (reservation.holder && reservation.holder != reservingObject)
+                    continue;
+
+                reservation.holder      = reservingObject;
+                reservation.description = descriptionOfAction;
+                done[item.second]       = true;
+                any                     = true;
+            }
+        }
+
+        if (!any)
+            return QList<QUrl>();
+
+        // The caller keeps the object alive during the call: it cannot be deleted before it is watched.
+
+        watch(q, reservingObject);
+
+        return pick(urls, done);
+    }
+
+    /** Release the reservations of @p holder when it is deleted, if it is not watched yet.
+     */
+    void watch(ReservationTable* const q, QObject* const holder)
+    {
+        QMutexLocker lock(&holdersMutex);
+
+        if (holders.contains(holder))
+            return;
+
+        holders.insert(holder);
+
+        // Direct connection: the object can be deleted in any thread, and is gone after the signal.
+
+        QObject::connect(holder, &QObject::destroyed,
+                         q, [this, q](QObject* object)
+            {
+                {
+                    QMutexLocker lock(&holdersMutex);
+                    holders.remove(object);
+                }
+
+                q->releaseAll(object);
+            },
+            Qt::DirectConnection
+        );
+    }
+
+    /** Release the reservations of @p urls made by @p reservingObject and return the items released,
+     *  without emitting any signal.
+     */
+    QList<QUrl> release(const QList<QUrl>& urls, QObject* const reservingObject)
+    {
+        if (!reservingObject || urls.isEmpty())
+            return QList<QUrl>();
+
+        const QVector<QVector<QPair<QUrl, int> > > batches = split(urls);
+        QVector<bool> done(urls.size(), false);
+        bool any = false;
+
+        for (int s = 0 ; s < s_shardCount ; ++s)
+        {
+            if (batches.at(s).isEmpty())
+                continue;
+
+            Shard& shard = shards[s];
+            QMutexLocker lock(&shard.mutex);
+
+            for (const QPair<QUrl, int>& item : batches.at(s))
+            {
+                auto it = shard.items.find(item.first);
+
+                if (it == shard.items.end() || it->holder != reservingObject)
+                    continue;
+
+                shard.items.erase(it);
+                done[item.second] = true;
+                any               = true;
+            }
+        }
+
+        if (!any)
+            return QList<QUrl>();
+
+        return pick(urls, done);
+    }
+
+public:
+
+    Shard           shards[s_shardCount];
+
+    /// Objects holding reservations, released when they are deleted.
+    QMutex          holdersMutex;
+    QSet<QObject*>  holders;
+};
+
+ReservationTable::ReservationTable(QObject* const parent)
+    : QObject(parent),
+      d(new Private)
+{
+}
+
+ReservationTable::~ReservationTable()
+{
+    QMutexLocker lock(&d->holdersMutex);
+
+    for (QObject* const holder : std::as_const(d->holders))
+    {
+        disconnect(holder, nullptr, this, nullptr);
+    }
+}
+
+bool ReservationTable::reserve(const QUrl& url, QObject* const reservingObject, const QString& descriptionOfAction)
+{
+    if (d->reserve(this, QList<QUrl>() << url, reservingObject, descriptionOfAction).isEmpty())
+        return false;
+
+    Q_EMIT itemReserved(url, descriptionOfAction);
+
+    return true;
+}
+
+QList<QUrl> ReservationTable::reserve(const QList<QUrl>& urls, QObject* const reservingObject,
+                                      const QString& descriptionOfAction)
+{
+    const QList<QUrl> reservedUrls = d->reserve(this, urls, reservingObject, descriptionOfAction);
+
+    if (!reservedUrls.isEmpty())
+    {
+        Q_EMIT reserved(reservedUrls, descriptionOfAction);
+    }
+
+    return reservedUrls;
+}
+
+void ReservationTable::release(const QUrl& url, QObject* const reservingObject)
+{
+    if (!d->release(QList<QUrl>() << url, reservingObject).isEmpty())
+    {
+        Q_EMIT itemReleased(url);
+    }
+}
+
+QList<QUrl> ReservationTable::release(const QList<QUrl>& urls, QObject* const reservingObject)
+{
+    const QList<QUrl> releasedUrls = d->release(urls, reservingObject);
+
+    if (!releasedUrls.isEmpty())
+    {
+        Q_EMIT released(releasedUrls);
+    }
+
+    return releasedUrls;
+}
+
+QList<QUrl> ReservationTable::releaseAll(QObject* const reservingObject)
+{
+    QList<QUrl> releasedUrls;
+
+    for (Private::Shard& shard : d->shards)
+    {
+        QMutexLocker lock(&shard.mutex);
+
+        for (auto it = shard.items.begin() ; it != shard.items.end() ; )
+        {
+            if (it->holder == reservingObject)
+            {
+                releasedUrls.append(it.key());
+                it = shard.items.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    if (!releasedUrls.isEmpty())
+    {
+        Q_EMIT released(releasedUrls);
+    }
+
+    return releasedUrls;
+}
+
+bool ReservationTable::isReserved(const QUrl& url, QString* const descriptionOfAction) const
+{
+    const QUrl key               = reservationKey(url);
+    const Private::Shard& shard  = d->shards[d->shardIndex(key)];
+    QMutexLocker lock(&shard.mutex);
+
+    auto it = shard.items.constFind(key);
+
+    if (it == shard.items.constEnd())
+        return false;
+
+    if (descriptionOfAction)
+        *descriptionOfAction = it->description;
+
+    return true;
+}
+
+QList<QUrl> ReservationTable::reservedItems(const QList<QUrl>& urls) const
+{
+    const QVector<QVector<QPair<QUrl, int> > > batches = d->split(urls);
+    QVector<bool> found(urls.size(), false);
+
+    for (int s = 0 ; s < s_shardCount ; ++s)
+    {
+        if (batches.at(s).isEmpty())
+            continue;
+
+        const Private::Shard& shard = d->shards[s];
+        QMutexLocker lock(&shard.mutex);
+
+        for (const QPair<QUrl, int>& item : batches.at(s))
+        {
+            found[item.second] = shard.items.contains(item.first);
+        }
+    }
+
+    return Private::pick(urls, found);
+}
+
+int ReservationTable::count() const
+{
+    int total = 0;
+
+    for (const Private::Shard& shard : d->shards)
+    {
+        QMutexLocker lock(&shard.mutex);
+        total += shard.items.size();
+    }
+
+    return total;
+}
+
+} // namespace KIPI
+
+#include "moc_reservationtable.cpp"
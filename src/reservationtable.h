@@ -0,0 +1,120 @@
+/*
+    SPDX-FileCopyrightText: 2004-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef KIPI_RESERVATIONTABLE_H
+#define KIPI_RESERVATIONTABLE_H
+
+// Std includes
+
+#include <memory>
+
+// Qt includes
+
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QUrl>
+
+// Local includes
+
+#include "libkipi_export.h"
+
+namespace KIPI
+{
+
+/** @class ReservationTable reservationtable.h <KIPI/ReservationTable>
+
+    Table of the items reserved by plugins for an action, which host applications can use to implement
+    the item reservation methods of Interface, as Interface::reserveForAction() and
+    Interface::reserveItemsForAction(), and support HostSupportsItemReservation feature.
+
+    Items are spread over independent shards by a hash of their URL, each protected by its own mutex, so
+    that reservations made from several threads do not contend. A batch of items locks each shard only once.
+
+    An item reserved by an object can be reserved again by the same object, to change the description of
+    the action, but not by another object until the reservation is released. Reservations are released
+    when the reserving object is deleted.
+
+    The reserved() and released() signals are emitted once per batch, with all items concerned, and the
+    itemReserved() and itemReleased() signals for each call made with a single item, as the matching
+    signals of Interface are.
+ */
+class LIBKIPI_EXPORT ReservationTable : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit ReservationTable(QObject* const parent = nullptr);
+    ~ReservationTable() override;
+
+    /**
+     * Reserve @p url for @p reservingObject. Return false if the item is already reserved
+     * by another object, or if @p reservingObject is null.
+     */
+    bool reserve(const QUrl& url, QObject* const reservingObject, const QString& descriptionOfAction);
+
+    /**
+     * Reserve all @p urls for @p reservingObject. Return the items which were reserved, in the order of @p urls:
+     * items already reserved by another object are skipped.
+     */
+    QList<QUrl> reserve(const QList<QUrl>& urls, QObject* const reservingObject, const QString& descriptionOfAction);
+
+    /**
+     * Release the reservation of @p url, if it was made by @p reservingObject.
+     */
+    void release(const QUrl& url, QObject* const reservingObject);
+
+    /**
+     * Release the reservation of all @p urls made by @p reservingObject. Return the items which were released.
+     */
+    QList<QUrl> release(const QList<QUrl>& urls, QObject* const reservingObject);
+
+    /**
+     * Release all reservations made by @p reservingObject. Return the items which were released.
+     */
+    QList<QUrl> releaseAll(QObject* const reservingObject);
+
+    /**
+     * Return true if @p url is reserved. If so, and @p descriptionOfAction is not null, it is set to
+     * the description of the action given when the item was reserved.
+     */
+    bool isReserved(const QUrl& url, QString* const descriptionOfAction = nullptr) const;
+
+    /**
+     * Return the items of @p urls which are reserved, in the order of @p urls.
+     */
+    QList<QUrl> reservedItems(const QList<QUrl>& urls) const;
+
+    /**
+     * Return the number of items reserved.
+     */
+    int count() const;
+
+Q_SIGNALS:
+
+    /// Emitted once for each batch of items reserved, from the thread where they were reserved.
+    void reserved(const QList<QUrl>& urls, const QString& descriptionOfAction);
+
+    /// Emitted once for each batch of items released, from the thread where they were released,
+    /// including the items released when their reserving object is deleted.
+    void released(const QList<QUrl>& urls);
+
+    /// Emitted when a single item is reserved, from the thread where it was reserved.
+    void itemReserved(const QUrl& url, const QString& descriptionOfAction);
+
+    /// Emitted when a single item is released, from the thread where it was released.
+    void itemReleased(const QUrl& url);
+
+private:
+
+    class Private;
+    std::unique_ptr<Private> const d;
+};
+
+} // namespace KIPI
+
+#endif /* KIPI_RESERVATIONTABLE_H */
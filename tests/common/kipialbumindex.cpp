@@ -0,0 +1,672 @@
+/*
+    SPDX-FileCopyrightText: 2011-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "kipialbumindex.h"
+
+// Qt includes
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QHash>
+#include <QMultiHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QSocketNotifier>
+#include <QFileSystemWatcher>
+#include <QDebug>
+
+// C ANSI includes
+
+#ifdef Q_OS_LINUX
+#   include <sys/inotify.h>
+#   include <unistd.h>
+#endif
+
+// Local includes
+
+#include "kipidirscanner.h"
+
+namespace KXMLKipiCmd
+{
+
+/// Identify the index file format. Increase version when the format change.
+static const quint32 s_indexMagic   = 0x4B495049;
+static const quint32 s_indexVersion = 1;
+
+class KipiAlbumIndex::Private
+{
+public:
+
+    class Album
+    {
+    public:
+
+        Album()
+            : recursive(false),
+              dirty(true),
+              generation(0),
+              version(0)
+        {
+        }
+
+        bool                   recursive;
+        bool                   dirty;
+
+        /// Increased each time a directory of the album changes, to detect changes made while it is scanned.
+        quint64                generation;
+
+        /// Identify the list of images, taken from Private::versions when it is built.
+        quint64                version;
+        QList<QUrl>            images;
+
+        /// Directories walked to list the album, with their modification time in ms since epoch.
+        QHash<QString, qint64> dirs;
+    };
+
+    class CachedEntry
+    {
+    public:
+
+        CachedEntry()
+            : verified(false)
+        {
+        }
+
+        Entry entry;
+
+        /// True once the entry has been checked against the file on disk during this session.
+        bool  verified;
+    };
+
+public:
+
+    Private()
+        : versions(0),
+          inotifyFd(-1),
+          notifier(nullptr),
+          watcher(nullptr),
+          modified(false)
+    {
+    }
+
+    void        watchDir(const QString& dir);
+    void        unwatchDir(const QString& dir);
+    QList<QUrl> dirChanged(const QString& dir, const QString& name, bool listChanged);
+    QList<QUrl> eventsLost();
+
+    static qint64 dirTime(const QString& dir)
+    {
+        const QFileInfo info(dir);
+
+        return (info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1);
+    }
+
+public:
+
+    QMutex                       mutex;
+
+    QHash<QString, Album>        albums;
+    QHash<QString, CachedEntry>  entries;
+
+    /// Number of lists of images built, to give a version to each one.
+    quint64                      versions;
+
+    /// Directory path to paths of albums which host it.
+    QMultiHash<QString, QString> dirAlbums;
+
+    /// Watched directories, by inotify watch descriptor and by path. The descriptor is -1 with QFileSystemWatcher.
+    QHash<int, QString>          watches;
+    QHash<QString, int>          watchedDirs;
+    int                          inotifyFd;
+    QSocketNotifier*             notifier;
+    QFileSystemWatcher*          watcher;
+
+    QString                      cacheFile;
+    bool                         modified;
+};
+
+void KipiAlbumIndex::Private::watchDir(const QString& dir)
+{
+    if (watchedDirs.contains(dir))
+        return;
+
+#ifdef Q_OS_LINUX
+
+    if (inotifyFd >= 0)
+    {
+        const int wd = ::inotify_add_watch(inotifyFd, QFile::encodeName(dir).constData(),
+                                           IN_CREATE      | IN_DELETE      | IN_MOVED_FROM  |
+                                           IN_MOVED_TO    | IN_CLOSE_WRITE | IN_ATTRIB      |
+                                           IN_DELETE_SELF | IN_MOVE_SELF   | IN_ONLYDIR);
+
+        if (wd >= 0)
+        {
+            watches.insert(wd, dir);
+            watchedDirs.insert(dir, wd);
+        }
+
+        return;
+    }
+
+#endif
+
+    if (watcher && watcher->addPath(dir))
+    {
+        watchedDirs.insert(dir, -1);
+    }
+}
+
+void KipiAlbumIndex::Private::unwatchDir(const QString& dir)
+{
+    QHash<QString, int>::iterator it = watchedDirs.find(dir);
+
+    if (it == watchedDirs.end())
+        return;
+
+#ifdef Q_OS_LINUX
+
+    if (inotifyFd >= 0 && it.value() >= 0)
+    {
+        ::inotify_rm_watch(inotifyFd, it.value());
+        watches.remove(it.value());
+    }
+
+#endif
+
+    if (watcher)
+    {
+        watcher->removePath(dir);
+    }
+
+    watchedDirs.erase(it);
+}
+
+QList<QUrl> KipiAlbumIndex::Private::dirChanged(const QString& dir, const QString& name, bool listChanged)
+{
+    QList<QUrl> changed;
+
+    // A file was written, renamed or removed: its properties must be read again.
+
+    if (!name.isEmpty() && entries.remove(dir + QLatin1Char('/') + name))
+    {
+        modified = true;
+    }
+
+    if (!listChanged)
+    {
+        return changed;
+    }
+
+    const QList<QString> paths = dirAlbums.values(dir);
+
+    for (const QString& path : paths)
+    {
+        Album& album = albums[path];
+        ++album.generation;
+
+        if (!album.dirty)
+        {
+            album.dirty = true;
+            modified    = true;
+            changed.append(QUrl::fromLocalFile(path));
+        }
+    }
+
+    return changed;
+}
+
+QList<QUrl> KipiAlbumIndex::Private::eventsLost()
+{
+    QList<QUrl> changed;
+
+    // Any album and any item may have changed: all are checked again on next use.
+
+    for (QHash<QString, Album>::iterator it = albums.begin() ; it != albums.end() ; ++it)
+    {
+        ++it->generation;
+
+        if (!it->dirty)
+        {
+            it->dirty = true;
+            changed.append(QUrl::fromLocalFile(it.key()));
+        }
+    }
+
+    for (QHash<QString, CachedEntry>::iterator it = entries.begin() ; it != entries.end() ; ++it)
+    {
+        it->verified = false;
+    }
+
+    // Watches dropped with the lost events are set again.
+
+    const QList<QString> dirs = watchedDirs.keys();
+
+    for (const QString& dir : dirs)
+    {
+        unwatchDir(dir);
+        watchDir(dir);
+    }
+
+    modified = true;
+
+    return changed;
+}
+
+// ---------------------------------------------------------------------------------------
+
+KipiAlbumIndex::KipiAlbumIndex(QObject* const parent)
+    : QObject(parent),
+      d(new Private)
+{
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QDir().mkpath(cacheDir);
+    d->cacheFile           = cacheDir + QLatin1String("/kipialbumindex.bin");
+
+#ifdef Q_OS_LINUX
+
+    d->inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (d->inotifyFd >= 0)
+    {
+        d->notifier = new QSocketNotifier(d->inotifyFd, QSocketNotifier::Read, this);
+
+        connect(d->notifier, SIGNAL(activated(int)),
+                this, SLOT(slotInotifyEvents()));
+    }
+
+#endif
+
+    if (!d->notifier)
+    {
+        d->watcher = new QFileSystemWatcher(this);
+
+        connect(d->watcher, &QFileSystemWatcher::directoryChanged,
+                this, &KipiAlbumIndex::slotDirectoryChanged);
+    }
+
+    load();
+}
+
+KipiAlbumIndex::~KipiAlbumIndex()
+{
+    save();
+
+#ifdef Q_OS_LINUX
+
+    if (d->inotifyFd >= 0)
+    {
+        delete d->notifier;
+        ::close(d->inotifyFd);
+    }
+
+#endif
+
+    delete d;
+}
+
+QString KipiAlbumIndex::cacheFile() const
+{
+    return d->cacheFile;
+}
+
+QList<QUrl> KipiAlbumIndex::images(const QUrl& album, bool recursive, quint64* const version)
+{
+    const QString path = album.toLocalFile();
+
+    if (path.isEmpty())
+    {
+        return QList<QUrl>();
+    }
+
+    quint64 generation = 0;
+
+    {
+        QMutexLocker lock(&d->mutex);
+        QHash<QString, Private::Album>::const_iterator it = d->albums.constFind(path);
+
+        if (it != d->albums.constEnd() && !it->dirty && it->recursive == recursive)
+        {
+            if (version)
+                *version = it->version;
+
+            return it->images;
+        }
+
+        generation = d->albums[path].generation;
+    }
+
+    // Scan the album outside of the lock, to not block the other clients of the index.
+    // Directories modified since the scan started, rounded down to the second for file
+    // systems with a coarse time resolution, may have been listed before the change.
+
+    const qint64      scanStart = QDateTime::currentMSecsSinceEpoch() / 1000 * 1000;
+    QStringList       dirs;
+    const QList<QUrl> images    = KipiDirScanner::defaultScanner().scan(album, recursive, &dirs);
+
+    QMutexLocker lock(&d->mutex);
+    Private::Album& entry = d->albums[path];
+    QStringList     oldDirs;
+
+    for (QHash<QString, qint64>::const_iterator it = entry.dirs.constBegin() ; it != entry.dirs.constEnd() ; ++it)
+    {
+        d->dirAlbums.remove(it.key(), path);
+        oldDirs.append(it.key());
+    }
+
+    entry.recursive = recursive;
+    entry.dirty     = (entry.generation != generation);
+    entry.images    = images;
+    entry.version   = ++d->versions;
+    entry.dirs.clear();
+
+    if (version)
+        *version = entry.version;
+
+    for (const QString& dir : std::as_const(dirs))
+    {
+        const qint64 time = Private::dirTime(dir);
+
+        if (time >= scanStart)
+        {
+            entry.dirty = true;
+        }
+
+        entry.dirs.insert(dir, time);
+        d->dirAlbums.insert(dir, path);
+        d->watchDir(dir);
+    }
+
+    // Stop watching directories which do not belong to any album anymore.
+
+    for (const QString& dir : std::as_const(oldDirs))
+    {
+        if (!d->dirAlbums.contains(dir))
+        {
+            d->unwatchDir(dir);
+        }
+    }
+
+    d->modified = true;
+
+    return images;
+}
+
+KipiAlbumIndex::Entry KipiAlbumIndex::entry(const QUrl& image)
+{
+    const QString path = image.toLocalFile();
+
+    if (path.isEmpty())
+    {
+        return Entry();
+    }
+
+    QMutexLocker lock(&d->mutex);
+    QHash<QString, Private::CachedEntry>::const_iterator it = d->entries.constFind(path);
+
+    if (it != d->entries.constEnd() && it->verified)
+    {
+        return it->entry;
+    }
+
+    lock.unlock();
+    const QFileInfo info(path);
+    lock.relock();
+
+    if (!info.exists())
+    {
+        d->entries.remove(path);
+        return Entry();
+    }
+
+    Private::CachedEntry& cached = d->entries[path];
+    const QDateTime modified     = info.lastModified();
+
+    if (cached.entry.size != info.size() || cached.entry.modified != modified)
+    {
+        // New item, or changed since the index was saved: the date taken must be read again.
+
+        cached.entry.size     = info.size();
+        cached.entry.modified = modified;
+        cached.entry.date     = QDateTime();
+        d->modified           = true;
+    }
+
+    cached.verified = true;
+
+    return cached.entry;
+}
+
+void KipiAlbumIndex::setDate(const QUrl& image, const QDateTime& date)
+{
+    if (!entry(image).isValid())
+    {
+        return;
+    }
+
+    QMutexLocker lock(&d->mutex);
+    QHash<QString, Private::CachedEntry>::iterator it = d->entries.find(image.toLocalFile());
+
+    if (it != d->entries.end())
+    {
+        it->entry.date = date;
+        d->modified    = true;
+    }
+}
+
+void KipiAlbumIndex::load()
+{
+    QFile file(d->cacheFile);
+
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0)
+    {
+        return;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic   = 0;
+    quint32 version = 0;
+    in >> magic >> version;
+
+    if (magic != s_indexMagic || version != s_indexVersion)
+    {
+        qDebug() << "Ignore album index with unsupported format" << d->cacheFile;
+        return;
+    }
+
+    QMutexLocker lock(&d->mutex);
+    qint32 count = 0;
+    in >> count;
+
+    for (qint32 i = 0 ; (i < count) && (in.status() == QDataStream::Ok) ; ++i)
+    {
+        QString        path;
+        Private::Album album;
+        in >> path >> album.recursive >> album.images >> album.dirs;
+
+        // Albums changed while the application was not running are rescanned on demand.
+
+        bool upToDate = true;
+
+        for (QHash<QString, qint64>::const_iterator it = album.dirs.constBegin() ; it != album.dirs.constEnd() ; ++it)
+        {
+            if (Private::dirTime(it.key()) != it.value())
+            {
+                upToDate = false;
+                break;
+            }
+        }
+
+        if (!upToDate)
+        {
+            continue;
+        }
+
+        album.dirty   = false;
+        album.version = ++d->versions;
+        d->albums.insert(path, album);
+
+        for (QHash<QString, qint64>::const_iterator it = album.dirs.constBegin() ; it != album.dirs.constEnd() ; ++it)
+        {
+            d->dirAlbums.insert(it.key(), path);
+            d->watchDir(it.key());
+        }
+    }
+
+    in >> count;
+
+    for (qint32 i = 0 ; (i < count) && (in.status() == QDataStream::Ok) ; ++i)
+    {
+        QString              path;
+        Private::CachedEntry cached;
+        in >> path >> cached.entry.size >> cached.entry.modified >> cached.entry.date;
+        d->entries.insert(path, cached);
+    }
+
+    if (in.status() != QDataStream::Ok)
+    {
+        qDebug() << "Album index is truncated" << d->cacheFile;
+    }
+
+    qDebug() << "Album index loaded:" << d->albums.size() << "albums," << d->entries.size() << "items";
+}
+
+bool KipiAlbumIndex::save()
+{
+    QMutexLocker lock(&d->mutex);
+
+    if (!d->modified)
+    {
+        return true;
+    }
+
+    QSaveFile file(d->cacheFile);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qDebug() << "Cannot write album index" << d->cacheFile;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << s_indexMagic << s_indexVersion;
+
+    qint32 count = 0;
+
+    for (QHash<QString, Private::Album>::const_iterator it = d->albums.constBegin() ; it != d->albums.constEnd() ; ++it)
+    {
+        if (!it->dirty)
+            ++count;
+    }
+
+    out << count;
+
+    for (QHash<QString, Private::Album>::const_iterator it = d->albums.constBegin() ; it != d->albums.constEnd() ; ++it)
+    {
+        if (!it->dirty)
+            out << it.key() << it->recursive << it->images << it->dirs;
+    }
+
+    out << qint32(d->entries.size());
+
+    for (QHash<QString, Private::CachedEntry>::const_iterator it = d->entries.constBegin() ; it != d->entries.constEnd() ; ++it)
+    {
+        out << it.key() << it->entry.size << it->entry.modified << it->entry.date;
+    }
+
+    if (!file.commit())
+    {
+        qDebug() << "Cannot write album index" << d->cacheFile;
+        return false;
+    }
+
+    d->modified = false;
+
+    return true;
+}
+
+void KipiAlbumIndex::slotInotifyEvents()
+{
+    QList<QUrl> changed;
+
+#ifdef Q_OS_LINUX
+
+    {
+        QMutexLocker lock(&d->mutex);
+        alignas(struct inotify_event) char buffer[4096];
+        ssize_t length = 0;
+
+        while ((length = ::read(d->inotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            for (const char* ptr = buffer ; ptr < buffer + length ; )
+            {
+                const struct inotify_event* const event = reinterpret_cast<const struct inotify_event*>(ptr);
+                ptr                                    += sizeof(struct inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    qDebug() << "Album index lost inotify events: all albums will be rescanned";
+                    changed << d->eventsLost();
+                    continue;
+                }
+
+                const QString dir                       = d->watches.value(event->wd);
+
+                if (dir.isEmpty())
+                {
+                    continue;
+                }
+
+                if (event->mask & IN_IGNORED)
+                {
+                    // The directory has been removed: the kernel dropped the watch.
+
+                    d->watches.remove(event->wd);
+                    d->watchedDirs.remove(dir);
+                    continue;
+                }
+
+                const QString name     = (event->len > 0) ? QFile::decodeName(event->name) : QString();
+                const bool listChanged = (event->mask & (IN_CREATE      | IN_DELETE    | IN_MOVED_FROM |
+                                                         IN_MOVED_TO    | IN_DELETE_SELF | IN_MOVE_SELF));
+
+                changed << d->dirChanged(dir, name, listChanged);
+            }
+        }
+    }
+
+#endif
+
+    for (const QUrl& album : std::as_const(changed))
+    {
+        Q_EMIT signalAlbumChanged(album);
+    }
+}
+
+void KipiAlbumIndex::slotDirectoryChanged(const QString& path)
+{
+    QList<QUrl> changed;
+
+    {
+        QMutexLocker lock(&d->mutex);
+        changed = d->dirChanged(path, QString(), true);
+    }
+
+    for (const QUrl& album : std::as_const(changed))
+    {
+        Q_EMIT signalAlbumChanged(album);
+    }
+}
+
+} // namespace KXMLKipiCmd
+
+#include "moc_kipialbumindex.cpp"
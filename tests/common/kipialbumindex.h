@@ -0,0 +1,115 @@
+/*
+    SPDX-FileCopyrightText: 2011-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef __KIPIALBUMINDEX_H
+#define __KIPIALBUMINDEX_H
+
+// Qt includes
+
+#include <QObject>
+#include <QList>
+#include <QUrl>
+#include <QDateTime>
+
+namespace KXMLKipiCmd
+{
+
+/**
+ * An index of albums contents used by the test host to serve collections from memory.
+ *
+ * Albums are scanned once with KipiDirScanner, and their directories are watched (through inotify
+ * under Linux) to rescan an album only when a file is added, removed or renamed. Properties of
+ * items (size, modification time, and date taken) are read on demand and kept up to date when a
+ * file is rewritten.
+ *
+ * The index is saved into the application cache directory when destroyed, and loaded at the
+ * next start. Albums whose directories changed while the application was not running are rescanned.
+ *
+ * All methods are thread-safe.
+ */
+class KipiAlbumIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /** Properties of an indexed item.
+     */
+    class Entry
+    {
+    public:
+
+        Entry()
+            : size(-1)
+        {
+        }
+
+        bool isValid() const
+        {
+            return (size >= 0);
+        }
+
+    public:
+
+        qint64    size;
+        QDateTime modified;
+
+        /// Date taken, as set with setDate(), or a null date if not yet known.
+        QDateTime date;
+    };
+
+public:
+
+    explicit KipiAlbumIndex(QObject* const parent = nullptr);
+    ~KipiAlbumIndex() override;
+
+    /** Return the images hosted by @p album, scanning the album only if it is not yet
+     *  indexed or if it changed on disk since the last call. If @p version is not null, it is
+     *  set to a number which changes each time the list of images of an album is rebuilt.
+     */
+    QList<QUrl> images(const QUrl& album, bool recursive, quint64* const version = nullptr);
+
+    /** Return the properties of @p image. An invalid entry is returned if the file does not exist.
+     */
+    Entry entry(const QUrl& image);
+
+    /** Store the date taken of @p image, to be saved with the index.
+     */
+    void setDate(const QUrl& image, const QDateTime& date);
+
+    /** Write the index to cacheFile(). This is done automatically when the index is destroyed.
+     */
+    bool save();
+
+    /** Return the path of the file used to save the index between sessions.
+     */
+    QString cacheFile() const;
+
+Q_SIGNALS:
+
+    /** Emitted when files have been added, removed or renamed in @p album.
+     *  Next call to images() will rescan it.
+     */
+    void signalAlbumChanged(const QUrl& album);
+
+private Q_SLOTS:
+
+    void slotInotifyEvents();
+    void slotDirectoryChanged(const QString& path);
+
+private:
+
+    void load();
+
+private:
+
+    class Private;
+    Private* const d;
+};
+
+} // namespace KXMLKipiCmd
+
+#endif // __KIPIALBUMINDEX_H
@@ -0,0 +1,334 @@
+/*
+    SPDX-FileCopyrightText: 2011-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "kipidirscanner.h"
+
+// C++ includes
+
+#include <algorithm>
+#include <cstring>
+
+// Qt includes
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMimeDatabase>
+#include <QMimeType>
+#include <QGlobalStatic>
+#include <QDebug>
+
+// C ANSI includes
+
+#ifdef Q_OS_UNIX
+#   include <dirent.h>
+#   include <sys/types.h>
+#   include <sys/stat.h>
+#endif
+
+// Libkipi includes
+
+#include "interface.h"
+
+using namespace KIPI;
+
+namespace KXMLKipiCmd
+{
+
+class KipiDirScanner::Private
+{
+public:
+
+    Private()
+    {
+        maxThreads = QThread::idealThreadCount();
+    }
+
+    /** Shared between all tasks of a recursive scan.
+     */
+    class ScanState
+    {
+    public:
+
+        QThreadPool pool;
+        QMutex      mutex;
+        QStringList files;
+        QStringList dirs;
+    };
+
+    /** Scan one directory and queue a new task for each of its sub-directories.
+     */
+    class ScanTask : public QRunnable
+    {
+    public:
+
+        ScanTask(const Private* const d, ScanState* const state, const QByteArray& path)
+            : m_d(d),
+              m_state(state),
+              m_path(path)
+        {
+        }
+
+        void run() override
+        {
+            QStringList       files;
+            QList<QByteArray> subDirs;
+
+            m_d->scanDir(m_path, files, &subDirs);
+
+            for (const QByteArray& subDir : std::as_const(subDirs))
+            {
+                m_state->pool.start(new ScanTask(m_d, m_state, subDir));
+            }
+
+            QMutexLocker lock(&m_state->mutex);
+            m_state->files.append(files);
+            m_state->dirs.append(QFile::decodeName(m_path));
+        }
+
+    private:
+
+        const Private* const m_d;
+        ScanState* const     m_state;
+        const QByteArray     m_path;
+    };
+
+public:
+
+    bool acceptName(const char* const name) const;
+    void scanDir(const QByteArray& path, QStringList& files, QList<QByteArray>* const subDirs) const;
+
+public:
+
+    /// Lower case file suffixes, without the dot.
+    QSet<QByteArray> suffixes;
+    int              maxThreads;
+};
+
+bool KipiDirScanner::Private::acceptName(const char* const name) const
+{
+    const char* const dot = ::strrchr(name, '.');
+
+    if (!dot || dot == name)
+        return false;
+
+    // Image suffixes are short: use a stack buffer to not allocate memory for each file.
+
+    char   suffix[16];
+    size_t length = 0;
+
+    for (const char* c = dot + 1 ; *c ; ++c)
+    {
+        if (length == sizeof(suffix))
+            return false;
+
+        suffix[length++] = ((*c >= 'A') && (*c <= 'Z')) ? char(*c - 'A' + 'a') : *c;
+    }
+
+    return suffixes.contains(QByteArray::fromRawData(suffix, int(length)));
+}
+
+void KipiDirScanner::Private::scanDir(const QByteArray& path, QStringList& files, QList<QByteArray>* const subDirs) const
+{
+#ifdef Q_OS_UNIX
+
+    DIR* const dir = ::opendir(path.constData());
+
+    if (!dir)
+    {
+        qDebug() << "Cannot open directory" << QFile::decodeName(path);
+        return;
+    }
+
+    QByteArray prefix = path;
+
+    if (!prefix.endsWith('/'))
+        prefix.append('/');
+
+    struct dirent* entry = nullptr;
+
+    while ((entry = ::readdir(dir)) != nullptr)
+    {
+        const char* const name = entry->d_name;
+
+        // Skip ".", ".." and hidden entries, as QDir do by default.
+
+        if (name[0] == '.')
+            continue;
+
+        const bool isImage = acceptName(name);
+        bool       isLink  = false;
+
+#ifdef DT_UNKNOWN
+        if (entry->d_type == DT_REG)
+        {
+            if (isImage)
+                files.append(QFile::decodeName(prefix + name));
+
+            continue;
+        }
+
+        if (entry->d_type == DT_DIR)
+        {
+            if (subDirs)
+                subDirs->append(prefix + name);
+
+            continue;
+        }
+
+        // Symbolic links are followed for files only, to not loop through the tree.
+
+        isLink = (entry->d_type == DT_LNK);
+#endif
+
+        if (!isImage && (!subDirs || isLink))
+            continue;
+
+        // The file system do not tell the entry type: we need to stat() it.
+
+        const QByteArray filePath = prefix + name;
+        struct stat st;
+
+        if (::stat(filePath.constData(), &st) != 0)
+            continue;
+
+        if (S_ISREG(st.st_mode))
+        {
+            if (isImage)
+                files.append(QFile::decodeName(filePath));
+        }
+        else if (S_ISDIR(st.st_mode) && subDirs && !isLink)
+        {
+            subDirs->append(filePath);
+        }
+    }
+
+    ::closedir(dir);
+
+#else // Q_OS_UNIX
+
+    QDir::Filters filters       = subDirs ? (QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot) : QDir::Files;
+    const QFileInfoList entries = QDir(QFile::decodeName(path)).entryInfoList(filters, QDir::Unsorted);
+
+    for (const QFileInfo& info : entries)
+    {
+        if (info.isDir())
+        {
+            if (!info.isSymLink())
+                subDirs->append(QFile::encodeName(info.absoluteFilePath()));
+        }
+        else if (acceptName(QFile::encodeName(info.fileName()).constData()))
+        {
+            files.append(info.absoluteFilePath());
+        }
+    }
+
+#endif // Q_OS_UNIX
+}
+
+// ---------------------------------------------------------------------------------------
+
+Q_GLOBAL_STATIC(KipiDirScanner, s_defaultScanner)
+
+KipiDirScanner::KipiDirScanner(const QStringList& mimeTypes)
+    : d(new Private)
+{
+    const QStringList types = mimeTypes.isEmpty() ? Interface::supportedImageMimeTypes()
+                                                  : mimeTypes;
+    QMimeDatabase db;
+
+    for (const QString& name : types)
+    {
+        const QMimeType mime = db.mimeTypeForName(name);
+
+        if (!mime.isValid())
+            continue;
+
+        const QStringList suffixes = mime.suffixes();
+
+        for (const QString& suffix : suffixes)
+        {
+            d->suffixes.insert(QFile::encodeName(suffix.toLower()));
+        }
+    }
+}
+
+KipiDirScanner::~KipiDirScanner()
+{
+    delete d;
+}
+
+const KipiDirScanner& KipiDirScanner::defaultScanner()
+{
+    return *s_defaultScanner;
+}
+
+void KipiDirScanner::setMaxThreads(int threads)
+{
+    d->maxThreads = qMax(1, threads);
+}
+
+int KipiDirScanner::maxThreads() const
+{
+    return d->maxThreads;
+}
+
+bool KipiDirScanner::accept(const QString& fileName) const
+{
+    return d->acceptName(QFile::encodeName(fileName).constData());
+}
+
+QList<QUrl> KipiDirScanner::scan(const QUrl& album, bool recursive, QStringList* const dirs) const
+{
+    QList<QUrl>   urls;
+    const QString albumPath = album.toLocalFile();
+
+    if (albumPath.isEmpty())
+    {
+        return urls;
+    }
+
+    QStringList files;
+
+    if (!recursive)
+    {
+        d->scanDir(QFile::encodeName(albumPath), files, nullptr);
+
+        if (dirs)
+            *dirs = QStringList() << albumPath;
+    }
+    else
+    {
+        Private::ScanState state;
+        state.pool.setMaxThreadCount(qMax(1, d->maxThreads));
+        state.pool.start(new Private::ScanTask(d, &state, QFile::encodeName(albumPath)));
+        state.pool.waitForDone();
+        files = state.files;
+
+        if (dirs)
+            *dirs = state.dirs;
+    }
+
+    // Tasks complete in any order: sort to report always the same list.
+
+    std::sort(files.begin(), files.end());
+    urls.reserve(files.size());
+
+    for (const QString& file : std::as_const(files))
+    {
+        urls.append(QUrl::fromLocalFile(file));
+    }
+
+    return urls;
+}
+
+} // namespace KXMLKipiCmd
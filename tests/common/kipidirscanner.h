@@ -0,0 +1,72 @@
+/*
+    SPDX-FileCopyrightText: 2011-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef __KIPIDIRSCANNER_H
+#define __KIPIDIRSCANNER_H
+
+// Qt includes
+
+#include <QList>
+#include <QUrl>
+#include <QStringList>
+
+namespace KXMLKipiCmd
+{
+
+/**
+ * Lists the image files hosted by an album directory.
+ *
+ * Only files which have a suffix registered by one of the MIME types passed to the constructor are
+ * reported, without calling stat() on each entry when the file system tells the entry type through readdir().
+ * Sub-directories can be walked recursively, in which case the sub-trees are scanned in parallel.
+ *
+ * The scanner is immutable once constructed and scan() can be called from several threads at the same time.
+ */
+class KipiDirScanner
+{
+public:
+
+    /** Build a scanner which accepts the files matching @p mimeTypes.
+     *  If the list is empty, the image MIME types readable by Qt are used.
+     */
+    explicit KipiDirScanner(const QStringList& mimeTypes = QStringList());
+    ~KipiDirScanner();
+
+    /** Return the image files found in @p album directory, sorted by path.
+     *  If @p recursive is true, sub-directories are scanned too, using up to maxThreads() threads.
+     *  If @p dirs is not null, it is filled with the paths of all directories walked, including the album one.
+     */
+    QList<QUrl> scan(const QUrl& album, bool recursive = false, QStringList* const dirs = nullptr) const;
+
+    /** Return true if @p fileName has a suffix matching one of the MIME types of the scanner.
+     */
+    bool accept(const QString& fileName) const;
+
+    /** Set the maximum number of threads used to walk sub-directories.
+     *  Default value is QThread::idealThreadCount().
+     */
+    void setMaxThreads(int threads);
+    int  maxThreads() const;
+
+    /** Return a scanner shared by the whole application which accept all image MIME types readable by Qt.
+     */
+    static const KipiDirScanner& defaultScanner();
+
+private:
+
+    // Disable
+    KipiDirScanner(const KipiDirScanner&);
+    KipiDirScanner& operator=(const KipiDirScanner&);
+
+private:
+
+    class Private;
+    Private* const d;
+};
+
+} // namespace KXMLKipiCmd
+
+#endif // __KIPIDIRSCANNER_H
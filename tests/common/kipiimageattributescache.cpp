@@ -0,0 +1,222 @@
+/*
+    SPDX-FileCopyrightText: 2011-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "kipiimageattributescache.h"
+
+// Qt includes
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QReadWriteLock>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QDebug>
+
+// Local includes
+
+#include "kipialbumindex.h"
+
+namespace KXMLKipiCmd
+{
+
+class KipiImageAttributesCache::Private
+{
+public:
+
+    Private(Interface* const i, KipiAlbumIndex* const idx)
+        : iface(i),
+          index(idx)
+    {
+    }
+
+    void fillDates(const QList<QUrl>& images);
+
+public:
+
+    Interface* const                        iface;
+    KipiAlbumIndex* const                   index;
+
+    QReadWriteLock                          lock;
+
+    /// Attributes set by plugins.
+    QHash<QUrl, QMap<QString, QVariant> >   attributes;
+
+    /// Item to the batch which hosts it. Lists are implicitly shared between all their items.
+    QHash<QUrl, QList<QUrl> >               batches;
+
+    /// Version of each batch registered.
+    QHash<QUrl, quint64>                    versions;
+
+    /// Serialize the batches, to not extract the same dates twice.
+    QMutex                                  fillMutex;
+};
+
+void KipiImageAttributesCache::Private::fillDates(const QList<QUrl>& images)
+{
+    // One processor for the whole batch.
+
+    MetadataProcessor* const meta = iface->createMetadataProcessor();
+    int count                     = 0;
+
+    for (const QUrl& url : images)
+    {
+        if (!url.isLocalFile())
+            continue;
+
+        const KipiAlbumIndex::Entry entry = index->entry(url);
+
+        if (!entry.isValid() || entry.date.isValid())
+            continue;
+
+        QDateTime date;
+
+        if (meta && meta->load(url))
+            date = meta->getImageDateTime();
+
+        // File modification date if there is no metadata.
+
+        if (!date.isValid())
+            date = entry.modified;
+
+        index->setDate(url, date);
+        ++count;
+    }
+
+    delete meta;
+
+    qDebug() << "Dates extracted for" << count << "items";
+}
+
+// ---------------------------------------------------------------------------------------
+
+KipiImageAttributesCache::KipiImageAttributesCache(Interface* const iface, KipiAlbumIndex* const index)
+    : d(new Private(iface, index))
+{
+}
+
+KipiImageAttributesCache::~KipiImageAttributesCache()
+{
+    delete d;
+}
+
+void KipiImageAttributesCache::registerBatch(const QUrl& batch, quint64 version, const QList<QUrl>& images)
+{
+    {
+        QReadLocker lock(&d->lock);
+        QHash<QUrl, quint64>::const_iterator it = d->versions.constFind(batch);
+
+        if (it != d->versions.constEnd() && it.value() == version)
+            return;
+    }
+
+    QWriteLocker lock(&d->lock);
+    d->versions.insert(batch, version);
+
+    for (const QUrl& url : images)
+    {
+        d->batches.insert(url, images);
+    }
+}
+
+QDateTime KipiImageAttributesCache::date(const QUrl& url)
+{
+    if (!url.isLocalFile())
+    {
+        qDebug() << "Date of non local files is not supported:" << url;
+        return QDateTime();
+    }
+
+    KipiAlbumIndex::Entry entry = d->index->entry(url);
+
+    if (!entry.isValid() || entry.date.isValid())
+    {
+        return entry.date;
+    }
+
+    QList<QUrl> batch;
+
+    {
+        QReadLocker lock(&d->lock);
+        batch = d->batches.value(url);
+    }
+
+    if (batch.isEmpty())
+    {
+        batch << url;
+    }
+
+    {
+        QMutexLocker fill(&d->fillMutex);
+        d->fillDates(batch);
+    }
+
+    return d->index->entry(url).date;
+}
+
+QMap<QString, QVariant> KipiImageAttributesCache::attributes(const QUrl& url)
+{
+    QMap<QString, QVariant> res;
+
+    {
+        QReadLocker lock(&d->lock);
+        res = d->attributes.value(url);
+    }
+
+    // Comment attribute
+    if (!res.contains(QString::fromLatin1("comment")))
+    {
+        res[QString::fromLatin1("comment")] = QString::fromLatin1("Image located at \"%1\"").arg(url.url());
+    }
+
+    // Date attribute
+    if (!res.contains(QString::fromLatin1("date")))
+    {
+        res[QString::fromLatin1("date")] = date(url);
+    }
+
+    return res;
+}
+
+void KipiImageAttributesCache::addAttributes(const QUrl& url, const QMap<QString, QVariant>& attributes)
+{
+    QWriteLocker lock(&d->lock);
+    QMap<QString, QVariant>& res = d->attributes[url];
+
+    for (QMap<QString, QVariant>::const_iterator it = attributes.constBegin() ; it != attributes.constEnd() ; ++it)
+    {
+        res.insert(it.key(), it.value());
+    }
+}
+
+void KipiImageAttributesCache::delAttributes(const QUrl& url, const QStringList& attributes)
+{
+    QWriteLocker lock(&d->lock);
+    QHash<QUrl, QMap<QString, QVariant> >::iterator it = d->attributes.find(url);
+
+    if (it == d->attributes.end())
+    {
+        return;
+    }
+
+    for (const QString& key : attributes)
+    {
+        it->remove(key);
+    }
+
+    if (it->isEmpty())
+    {
+        d->attributes.erase(it);
+    }
+}
+
+void KipiImageAttributesCache::clearAttributes(const QUrl& url)
+{
+    QWriteLocker lock(&d->lock);
+    d->attributes.remove(url);
+}
+
+} // namespace KXMLKipiCmd
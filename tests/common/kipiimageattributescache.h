@@ -0,0 +1,81 @@
+/*
+    SPDX-FileCopyrightText: 2011-2018 Gilles Caulier <caulier dot gilles at gmail dot com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef __KIPIIMAGEATTRIBUTESCACHE_H
+#define __KIPIIMAGEATTRIBUTESCACHE_H
+
+// Qt includes
+
+#include <QList>
+#include <QMap>
+#include <QUrl>
+#include <QVariant>
+#include <QStringList>
+
+// Libkipi includes
+
+#include "interface.h"
+
+using namespace KIPI;
+
+namespace KXMLKipiCmd
+{
+
+class KipiAlbumIndex;
+
+/**
+ * Attributes of items shared by all ImageInfo handles created by the test host.
+ *
+ * Attributes set by plugins are kept in memory for the whole session. The "date" attribute is read
+ * from metadata through Interface::createMetadataProcessor(), falling back to the file modification
+ * time, and is stored in the album index to survive between sessions.
+ *
+ * Dates are extracted by batch: when the date of an item is not known, all items of the collection
+ * registered with registerBatch() which hosts it are processed in one pass, so sorting a collection
+ * by date do not walk files once per lookup.
+ *
+ * All methods are thread-safe.
+ */
+class KipiImageAttributesCache
+{
+public:
+
+    KipiImageAttributesCache(Interface* const iface, KipiAlbumIndex* const index);
+    ~KipiImageAttributesCache();
+
+    QMap<QString, QVariant> attributes(const QUrl& url);
+    void                    addAttributes(const QUrl& url, const QMap<QString, QVariant>& attributes);
+    void                    delAttributes(const QUrl& url, const QStringList& attributes);
+    void                    clearAttributes(const QUrl& url);
+
+    /** Register @p images as items processed together when one of their dates is missing.
+     *  Typically, the contents of a collection returned to plugins.
+     *
+     *  @p batch identifies the collection, as the album URL, and @p version its contents. Nothing is
+     *  done if the same version of the batch is already registered, so a collection can be registered
+     *  each time it is returned to plugins without walking its items again.
+     */
+    void registerBatch(const QUrl& batch, quint64 version, const QList<QUrl>& images);
+
+    /** Return the date of @p url. A null date is returned for non local files.
+     */
+    QDateTime date(const QUrl& url);
+
+private:
+
+    // Disable
+    KipiImageAttributesCache(const KipiImageAttributesCache&);
+    KipiImageAttributesCache& operator=(const KipiImageAttributesCache&);
+
+private:
+
+    class Private;
+    Private* const d;
+};
+
+} // namespace KXMLKipiCmd
+
+#endif // __KIPIIMAGEATTRIBUTESCACHE_H
@@ -6,30 +6,27 @@
 
 #include "kipiimagecollectionshared.h"
 
-// Qt includes
+// Local includes
 
-#include <QDir>
+#include "kipidirscanner.h"
 
 namespace KXMLKipiCmd
 {
 
-KipiImageCollectionShared::KipiImageCollectionShared(const QUrl& albumPath)
+KipiImageCollectionShared::KipiImageCollectionShared(const QUrl& albumPath, bool recursive)
     : ImageCollectionShared(),
       m_albumPath(albumPath),
       m_images()
 {
-    // go through the album and add its images:
-    const QString albumPathString = m_albumPath.toLocalFile();
-
-    // add only the files, because recursion through directories should be
-    // handled in KipiInterface::add[Selected]Album
-    // TODO: restrict the search to images!
-    const QFileInfoList files     = QDir(albumPathString).entryInfoList(QDir::Files);
-
-    for (QFileInfoList::const_iterator it = files.constBegin(); it!=files.constEnd(); ++it)
-    {
-            m_images.append(QUrl::fromLocalFile(it->absoluteFilePath()));
-    }
+    // go through the album and add its images, including the sub-directories contents if requested.
+    m_images = KipiDirScanner::defaultScanner().scan(m_albumPath, recursive);
+}
+
+KipiImageCollectionShared::KipiImageCollectionShared(const QUrl& albumPath, const QList<QUrl>& images)
+    : ImageCollectionShared(),
+      m_albumPath(albumPath),
+      m_images(images)
+{
 }
 
 KipiImageCollectionShared::KipiImageCollectionShared(const QList<QUrl>& images)
@@ -21,7 +21,8 @@ class KipiImageCollectionShared : public ImageCollectionShared
 public:
 
     // re-implemented inherited functions:
-    KipiImageCollectionShared(const QUrl& albumPath);
+    explicit KipiImageCollectionShared(const QUrl& albumPath, bool recursive = false);
+    KipiImageCollectionShared(const QUrl& albumPath, const QList<QUrl>& images);
     KipiImageCollectionShared(const QList<QUrl>& images);
     ~KipiImageCollectionShared() override;
 
@@ -9,10 +9,13 @@
 
 // Qt includes
 
-#include <QFileInfo>
 #include <QStringList>
 #include <QDebug>
 
+// Local includes
+
+#include "kipiimageattributescache.h"
+
 namespace KXMLKipiCmd
 {
 
@@ -20,16 +23,17 @@ class KipiImageInfoShared::Private
 {
 public:
 
-    Private()
+    explicit Private(KipiImageAttributesCache* const c)
+        : cache(c)
     {
     }
 
-    QDateTime dateTime;
+    KipiImageAttributesCache* const cache;
 };
 
-KipiImageInfoShared::KipiImageInfoShared(Interface* const interface, const QUrl& url)
+KipiImageInfoShared::KipiImageInfoShared(Interface* const interface, const QUrl& url, KipiImageAttributesCache* const cache)
     : ImageInfoShared(interface, url),
-      d(new Private())
+      d(new Private(cache))
 {
 }
 
@@ -42,33 +46,14 @@ QMap<QString, QVariant> KipiImageInfoShared::attributes()
 {
     qDebug() << "QMap<QString,QVariant> attributes()";
 
-    QMap<QString, QVariant> res;
-
-    // Comment attribute
-    res[QString::fromLatin1("comment")] = QString::fromLatin1("Image located at \"%1\"").arg(_url.url());
-
-    // Date attribute
-    if (!d->dateTime.isValid())
-    {
-        if ( ! _url.isLocalFile() )
-        {
-            qFatal("KIPI::ImageInfoShared::time does not yet support non local files, please fix\n");
-            d->dateTime = QDateTime();
-        }
-        else
-        {
-            // File creation date only
-            d->dateTime = QFileInfo( _url.toLocalFile() ).lastModified();
-        }
-    }
-
-    res[QString::fromLatin1("date")] = d->dateTime;
-
-    return res;
+    return d->cache->attributes(_url);
 }
+
 void KipiImageInfoShared::clearAttributes()
 {
     qDebug() << "void KipiImageInfoShared::clearAttributes()";
+
+    d->cache->clearAttributes(_url);
 }
 
 void KipiImageInfoShared::addAttributes(const QMap<QString, QVariant>& attributes)
@@ -84,12 +69,16 @@ void KipiImageInfoShared::addAttributes(const QMap<QString, QVariant>& attribute
         qDebug() << QString::fromLatin1("attribute( \"%1\" ), value( \"%2\" )").arg(key).arg(val);
         ++it;
     }
+
+    d->cache->addAttributes(_url, attributes);
 }
 
 void KipiImageInfoShared::delAttributes(const QStringList& attributes)
 {
     qDebug() << "void KipiImageInfoShared::delAttributes()";
     qDebug() << QString::fromLatin1("attributes : \"%1\"").arg(attributes.join(QString::fromLatin1(", ")));
+
+    d->cache->delAttributes(_url, attributes);
 }
 
 } // namespace KXMLKipiCmd
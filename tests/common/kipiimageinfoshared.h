@@ -17,11 +17,13 @@ using namespace KIPI;
 namespace KXMLKipiCmd
 {
 
+class KipiImageAttributesCache;
+
 class KipiImageInfoShared : public ImageInfoShared
 {
 public:
 
-    KipiImageInfoShared(Interface* const interface, const QUrl& url);
+    KipiImageInfoShared(Interface* const interface, const QUrl& url, KipiImageAttributesCache* const cache);
     ~KipiImageInfoShared() override;
 
     QMap<QString, QVariant> attributes() override;
@@ -13,11 +13,15 @@
 #include <QDebug>
 #include <QIcon>
 #include <QFileInfo>
+#include <QSet>
 
 // Libkipi includes
 
 #include "libkipi_version.h"
 #include "imagecollection.h"
+#include "profiler.h"
+#include "reservationtable.h"
+#include "filereadwritelockregistry.h"
 
 // KF includes
 
@@ -32,6 +36,8 @@
 #include "kipiuploadwidget.h"
 #include "kipiimagecollectionshared.h"
 #include "kipiwriteimage.h"
+#include "kipialbumindex.h"
+#include "kipiimageattributescache.h"
 
 namespace KXMLKipiCmd
 {
@@ -39,13 +45,37 @@ namespace KXMLKipiCmd
 KipiInterface::KipiInterface(QObject* const parent, const QString& name)
     : Interface(parent, name),
       m_selectedImages(),
+      m_selectionVersion(1),
       m_selectedAlbums(),
-      m_albums()
+      m_albums(),
+      m_allAlbumsCacheValid(false),
+      m_albumsVersion(1),
+      m_recursiveAlbums(false),
+      m_albumIndex(new KipiAlbumIndex(this)),
+      m_attributesCache(new KipiImageAttributesCache(this, m_albumIndex)),
+      m_reservations(new ReservationTable(this)),
+      m_fileLocks(new FileReadWriteLockRegistry)
 {
+    connect(m_albumIndex, &KipiAlbumIndex::signalAlbumChanged,
+            this, &KipiInterface::slotAlbumChanged);
+
+    connect(m_reservations, &ReservationTable::reserved,
+            this, &KipiInterface::itemsReservedForAction);
+
+    connect(m_reservations, &ReservationTable::released,
+            this, &KipiInterface::reservationsCleared);
+
+    connect(m_reservations, &ReservationTable::itemReserved,
+            this, &KipiInterface::reservedForAction);
+
+    connect(m_reservations, &ReservationTable::itemReleased,
+            this, &KipiInterface::reservationCleared);
 }
 
 KipiInterface::~KipiInterface()
 {
+    delete m_attributesCache;
+    delete m_fileLocks;
 }
 
 ImageCollection KipiInterface::currentAlbum()
@@ -59,42 +89,93 @@ ImageCollection KipiInterface::currentAlbum()
         currentAlbumUrl = m_selectedAlbums.at(0);
     }
 
-    return (ImageCollection(new KipiImageCollectionShared(currentAlbumUrl)));
+    quint64           version = 0;
+    const QList<QUrl> images  = m_albumIndex->images(currentAlbumUrl, m_recursiveAlbums, &version);
+    m_attributesCache->registerBatch(currentAlbumUrl, version, images);
+
+    return (ImageCollection(new KipiImageCollectionShared(currentAlbumUrl, images)));
 }
 
 ImageCollection KipiInterface::currentSelection()
 {
     qDebug() << "Called by plugins";
 
+    // The selection is registered as a batch without URL.
+
+    m_attributesCache->registerBatch(QUrl(), m_selectionVersion, m_selectedImages);
+
     return (ImageCollection(new KipiImageCollectionShared(m_selectedImages)));
 }
 
 QList<ImageCollection> KipiInterface::allAlbums()
 {
+    if (m_allAlbumsCacheValid)
+    {
+        return m_allAlbumsCache;
+    }
+
     QList<ImageCollection> listAllAlbums;
+    QSet<QUrl>             knownAlbums;
+    listAllAlbums.reserve(m_albums.size() + m_selectedAlbums.size());
+    knownAlbums.reserve(m_albums.size() + m_selectedAlbums.size());
 
     for (QList<QUrl>::const_iterator it = m_albums.constBegin(); it!=m_albums.constEnd(); ++it)
     {
-        listAllAlbums.append(ImageCollection(new KipiImageCollectionShared(*it)));
+        if (!knownAlbums.contains(*it))
+        {
+            knownAlbums.insert(*it);
+            quint64           version = 0;
+            const QList<QUrl> images  = m_albumIndex->images(*it, m_recursiveAlbums, &version);
+            m_attributesCache->registerBatch(*it, version, images);
+            listAllAlbums.append(ImageCollection(new KipiImageCollectionShared(*it, images)));
+        }
     }
 
     // make sure albums which have been specified as selectedalbums are also in the allAlbums list:
     for (QList<QUrl>::const_iterator it = m_selectedAlbums.constBegin(); it!=m_selectedAlbums.constEnd(); ++it)
     {
-        if (!m_albums.contains(*it))
+        if (!knownAlbums.contains(*it))
         {
-            listAllAlbums.append(ImageCollection(new KipiImageCollectionShared(*it)));
+            knownAlbums.insert(*it);
+            quint64           version = 0;
+            const QList<QUrl> images  = m_albumIndex->images(*it, m_recursiveAlbums, &version);
+            m_attributesCache->registerBatch(*it, version, images);
+            listAllAlbums.append(ImageCollection(new KipiImageCollectionShared(*it, images)));
         }
     }
 
+    m_allAlbumsCache      = listAllAlbums;
+    m_allAlbumsCacheValid = true;
+
     return listAllAlbums;
 }
 
+quint64 KipiInterface::albumsVersion() const
+{
+    return m_albumsVersion;
+}
+
+void KipiInterface::albumsListChanged()
+{
+    m_allAlbumsCache.clear();
+    m_allAlbumsCacheValid = false;
+    ++m_albumsVersion;
+
+    Q_EMIT albumsChanged();
+}
+
+void KipiInterface::slotAlbumChanged(const QUrl& album)
+{
+    qDebug() << "Album changed on disk:" << album;
+
+    albumsListChanged();
+}
+
 ImageInfo KipiInterface::info(const QUrl& url)
 {
     qDebug() << QString::fromLatin1( "Plugin wants information about image \"%1\"").arg( url.url() );
 
-    return (ImageInfo(new KipiImageInfoShared(this, url)));
+    return (ImageInfo(new KipiImageInfoShared(this, url, m_attributesCache)));
 }
 
 bool KipiInterface::addImage(const QUrl& url, QString& errmsg)
@@ -125,6 +206,8 @@ int KipiInterface::features() const
     qDebug() << "Called by plugins";
 
     return   ImagesHasTime
+           | HostSupportsItemReservation
+           | HostSupportsReadWriteLock
 #ifdef HAVE_KEXIV2
            | HostSupportsMetadataProcessing
 #endif
@@ -149,11 +232,13 @@ UploadWidget* KipiInterface::uploadWidget(QWidget* parent)
 void KipiInterface::addSelectedImages(const QList<QUrl>& images)
 {
     m_selectedImages.append(images);
+    ++m_selectionVersion;
 }
 
 void KipiInterface::addSelectedImage(const QUrl& image)
 {
     m_selectedImages.append(image);
+    ++m_selectionVersion;
 }
 
 void KipiInterface::addAlbums(const QList<QUrl>& albums)
@@ -167,8 +252,7 @@ void KipiInterface::addAlbums(const QList<QUrl>& albums)
 void KipiInterface::addAlbum(const QUrl& album)
 {
     m_albums.append(album);
-
-    // TODO: recurse through sub-directories?
+    albumsListChanged();
 }
 
 void KipiInterface::addSelectedAlbums(const QList<QUrl>& albums)
@@ -182,8 +266,33 @@ void KipiInterface::addSelectedAlbums(const QList<QUrl>& albums)
 void KipiInterface::addSelectedAlbum(const QUrl& album)
 {
     m_selectedAlbums.append(album);
+    albumsListChanged();
+}
+
+void KipiInterface::clearImagesAndAlbums()
+{
+    if (m_selectedImages.isEmpty() && m_selectedAlbums.isEmpty() && m_albums.isEmpty())
+        return;
+
+    m_selectedImages.clear();
+    ++m_selectionVersion;
+    m_selectedAlbums.clear();
+    m_albums.clear();
+    albumsListChanged();
+}
 
-    // TODO: recurse through sub-directories?
+void KipiInterface::setRecursiveAlbums(bool recursive)
+{
+    if (recursive == m_recursiveAlbums)
+        return;
+
+    m_recursiveAlbums = recursive;
+    albumsListChanged();
+}
+
+bool KipiInterface::recursiveAlbums() const
+{
+    return m_recursiveAlbums;
 }
 
 QVariant KipiInterface::hostSetting(const QString& settingName)
@@ -205,6 +314,14 @@ bool KipiInterface::saveImage(const QUrl& url, const QString& format,
                               const QByteArray& data, uint width, uint height,
                               bool  sixteenBit, bool hasAlpha, bool* cancel)
 {
+    KIPI::Profiler::Scope scope("KipiInterface::saveImage");
+
+    if (KIPI::Profiler::isEnabled())
+    {
+        KIPI::Profiler::addCount(QLatin1String("saved images"), QString(), 1);
+        KIPI::Profiler::addCount(QLatin1String("saved bytes"),  QString(), data.size());
+    }
+
     KIPIWriteImage writer;
     writer.setImageData(data, width, height, sixteenBit, hasAlpha);
     writer.setCancel(cancel);
@@ -505,9 +622,43 @@ MetadataProcessor* KipiInterface::createMetadataProcessor() const
 
 // ---------------------------------------------------------------------------------------
 
-FileReadWriteLock* KipiInterface::createReadWriteLock(const QUrl&) const
+FileReadWriteLock* KipiInterface::createReadWriteLock(const QUrl& url) const
+{
+    return m_fileLocks->createReadWriteLock(url);
+}
+
+// ---------------------------------------------------------------------------------------
+
+bool KipiInterface::reserveForAction(const QUrl& url, QObject* const reservingObject,
+                                     const QString& descriptionOfAction) const
+{
+    return m_reservations->reserve(url, reservingObject, descriptionOfAction);
+}
+
+void KipiInterface::clearReservation(const QUrl& url, QObject* const reservingObject)
+{
+    m_reservations->release(url, reservingObject);
+}
+
+bool KipiInterface::itemIsReserved(const QUrl& url, QString* const descriptionOfAction) const
+{
+    return m_reservations->isReserved(url, descriptionOfAction);
+}
+
+QList<QUrl> KipiInterface::reserveItemsForAction(const QList<QUrl>& urls, QObject* const reservingObject,
+                                                 const QString& descriptionOfAction) const
+{
+    return m_reservations->reserve(urls, reservingObject, descriptionOfAction);
+}
+
+void KipiInterface::clearReservations(const QList<QUrl>& urls, QObject* const reservingObject)
+{
+    m_reservations->release(urls, reservingObject);
+}
+
+QList<QUrl> KipiInterface::reservedItems(const QList<QUrl>& urls) const
 {
-    return nullptr;  // TODO
+    return m_reservations->reservedItems(urls);
 }
 
 } // namespace KXMLKipiCmd
@@ -11,11 +11,14 @@
 // Libkipi includes
 
 #include "interface.h"
+#include "imagecollection.h"
 
 namespace KIPI
 {
     class ImageCollection;
     class ImageInfo;
+    class ReservationTable;
+    class FileReadWriteLockRegistry;
 }
 
 using namespace KIPI;
@@ -23,6 +26,9 @@ using namespace KIPI;
 namespace KXMLKipiCmd
 {
 
+class KipiAlbumIndex;
+class KipiImageAttributesCache;
+
 class KipiInterface : public Interface
 {
     Q_OBJECT
@@ -35,6 +41,7 @@ public:
     ImageCollection        currentAlbum() override;
     ImageCollection        currentSelection() override;
     QList<ImageCollection> allAlbums() override;
+    quint64                albumsVersion() const override;
     ImageInfo              info(const QUrl&) override;
 
     bool addImage(const QUrl& url, QString& errmsg) override;
@@ -56,6 +63,15 @@ public:
     void addAlbums(const QList<QUrl>& albums);
     void addAlbum(const QUrl& album);
 
+    /** Forget all images and albums added before, to run a new job with the same plugins.
+     */
+    void clearImagesAndAlbums();
+
+    /** If enabled, the images hosted in sub-directories of albums are also reported in collections.
+     */
+    void setRecursiveAlbums(bool recursive);
+    bool recursiveAlbums() const;
+
     void thumbnails(const QList<QUrl>& list, int size) override;
 
     bool saveImage(const QUrl& url, const QString& format,
@@ -66,11 +82,50 @@ public:
     FileReadWriteLock* createReadWriteLock(const QUrl&) const override;
     MetadataProcessor* createMetadataProcessor()        const override;
 
+    bool        reserveForAction(const QUrl& url, QObject* const reservingObject,
+                                 const QString& descriptionOfAction) const override;
+    void        clearReservation(const QUrl& url, QObject* const reservingObject) override;
+    bool        itemIsReserved(const QUrl& url, QString* const descriptionOfAction = nullptr) const override;
+
+    QList<QUrl> reserveItemsForAction(const QList<QUrl>& urls, QObject* const reservingObject,
+                                      const QString& descriptionOfAction) const override;
+    void        clearReservations(const QList<QUrl>& urls, QObject* const reservingObject) override;
+    QList<QUrl> reservedItems(const QList<QUrl>& urls) const override;
+
+private Q_SLOTS:
+
+    void slotAlbumChanged(const QUrl& album);
+
+private:
+
+    void albumsListChanged();
+
 private:
 
-    QList<QUrl> m_selectedImages;
-    QList<QUrl> m_selectedAlbums;
-    QList<QUrl> m_albums;
+    QList<QUrl>            m_selectedImages;
+
+    /// Increased each time the selected images change.
+    quint64                m_selectionVersion;
+    QList<QUrl>            m_selectedAlbums;
+    QList<QUrl>            m_albums;
+
+    /// Collections returned by allAlbums(), rebuilt only when albums list change.
+    QList<ImageCollection> m_allAlbumsCache;
+    bool                   m_allAlbumsCacheValid;
+    quint64                m_albumsVersion;
+    bool                   m_recursiveAlbums;
+
+    /// Contents of albums, kept up to date with the files on disk.
+    KipiAlbumIndex*        m_albumIndex;
+
+    /// Attributes shared by all ImageInfo handles.
+    KipiImageAttributesCache* m_attributesCache;
+
+    /// Items reserved by plugins.
+    ReservationTable*      m_reservations;
+
+    /// Locks of files read and written by plugins.
+    FileReadWriteLockRegistry* m_fileLocks;
 
 private:
 
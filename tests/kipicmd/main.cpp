@@ -17,14 +17,30 @@
 #include <QUrl>
 #include <QStandardPaths>
 #include <QApplication>
+#include <QWidget>
 #include <QCommandLineParser>
 #include <QCommandLineOption>
+#include <QThread>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QRunnable>
+#include <QVector>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QFile>
+#include <QProcess>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QMap>
 
 // Libkipi includes
 
 #include "libkipi_version.h"
 #include "plugin.h"
 #include "pluginloader.h"
+#include "pluginworker.h"
+#include "profiler.h"
 #include "kipiinterface.h"
 
 #ifdef HAVE_KEXIV2
@@ -160,6 +176,22 @@ bool LoadPlugins(const QString& libraryName = QString::fromLatin1(""))
     return false;
 }
 
+/// Parent widget given to plugins, created by the first job which needs it. Deleted by main().
+static std::unique_ptr<QWidget> s_hostWidget;
+
+/**
+* \brief Returns the parent widget given to plugins, shared by all jobs
+*/
+QWidget* HostWidget()
+{
+    if (!s_hostWidget)
+    {
+        s_hostWidget.reset(new QWidget());
+    }
+
+    return s_hostWidget.get();
+}
+
 /**
 * \brief Lists the available plugins and their actions
 * \param libraryName Load only plugin found in library libraryName
@@ -177,7 +209,7 @@ bool ListPlugins(const QString& libraryName = QString::fromLatin1(""))
     const int nPlugins                        = pluginList.size();
     const int nDigits                         = QString::number(nPlugins).size();
     const QString preSpace                    = QString(nDigits+1+1, QChar::fromLatin1(' '));
-    QWidget* const dummyWidget                = new QWidget();
+    QWidget* const dummyWidget                = HostWidget();
 
     qDebug() << QString::fromLatin1("Found %1 plugin(s):").arg(nPlugins);
 
@@ -198,7 +230,11 @@ bool ListPlugins(const QString& libraryName = QString::fromLatin1(""))
             continue;
         }
 
-        plugin->setup(dummyWidget);
+        {
+            Profiler::Scope scope("Plugin::setup", (*it)->uname());
+            plugin->setup(dummyWidget);
+        }
+
         const QList<QPair<int, QAction*> > actionsList = FlattenActionList(plugin->actions());
 
         qDebug() << preSpace << QString::fromLatin1("Actions:");
@@ -219,7 +255,7 @@ bool ListPlugins(const QString& libraryName = QString::fromLatin1(""))
 
 /**
 * \brief Calls an action of a plugin
-* \param actionText Text of the action to call
+* \param actionText Name or text of the action to call
 * \param libraryName Load only the plugin in this library
 * \returns False if the action could not be called
 */
@@ -234,10 +270,39 @@ bool CallAction(const QString& actionText, const QString& libraryName = QString:
 
     PluginLoader::PluginList pluginList = kipiPluginLoader->pluginList();
 
-    QWidget* const dummyWidget = new QWidget();
+    QWidget* const dummyWidget = HostWidget();
 
     bool foundAction = false;
 
+    // Look first at actions declared in desktop files, to load only the plugin which provides the action.
+
+    for (PluginLoader::PluginList::ConstIterator info = pluginList.constBegin();
+         (info!=pluginList.constEnd()) && !foundAction; ++info)
+    {
+        if ( !(*info)->shouldLoad() || ( !libraryName.isEmpty() && ( (*info)->library() != libraryName ) ) )
+            continue;
+
+        const QList<QAction*> stubs = (*info)->actionStubs(dummyWidget);
+
+        for (QAction* const stub : stubs)
+        {
+            if ( stub->text() != actionText && stub->objectName() != actionText )
+                continue;
+
+            qDebug() << QString::fromLatin1("Found declared action \"%1\" in library \"%2\", will now call it.").arg(actionText).arg((*info)->library());
+
+            {
+                Profiler::Scope scope("QAction::trigger", (*info)->uname());
+                stub->trigger();
+            }
+
+            qDebug() << QString::fromLatin1("Plugin is done.");
+            foundAction = true;
+
+            break;
+        }
+    }
+
     for (PluginLoader::PluginList::ConstIterator info = pluginList.constBegin();
          (info!=pluginList.constEnd()) && !foundAction; ++info)
     {
@@ -253,7 +318,30 @@ bool CallAction(const QString& actionText, const QString& libraryName = QString:
             continue;
         }
 
-        plugin->setup(dummyWidget/*.get()*/);
+        {
+            Profiler::Scope scope("Plugin::setup", (*info)->uname());
+            plugin->setup(dummyWidget);
+        }
+
+        // Actions are indexed by name in the loader when the plugin is set up.
+
+        QAction* const namedAction = kipiPluginLoader->action(actionText);
+
+        if (namedAction)
+        {
+            qDebug() << QString::fromLatin1("Found action named \"%1\" in library \"%2\", will now call it.").arg(actionText).arg((*info)->library());
+
+            {
+                Profiler::Scope scope("QAction::trigger", (*info)->uname());
+                namedAction->trigger();
+            }
+
+            qDebug() << QString::fromLatin1("Plugin is done.");
+            foundAction = true;
+
+            continue;
+        }
+
         const QList<QPair<int, QAction*> > actionsList = FlattenActionList(plugin->actions());
 
         for (QList<QPair<int, QAction*> >::ConstIterator it = actionsList.constBegin();
@@ -268,7 +356,11 @@ bool CallAction(const QString& actionText, const QString& libraryName = QString:
             qDebug() << QString::fromLatin1("Found action \"%1\" in library \"%2\", will now call it.").arg(actionText).arg((*info)->library());
 
             // call the action:
-            pluginAction->trigger();
+            {
+                Profiler::Scope scope("QAction::trigger", (*info)->uname());
+                pluginAction->trigger();
+            }
+
             qDebug() << QString::fromLatin1("Plugin is done.");
             foundAction = true;
 
@@ -282,41 +374,171 @@ bool CallAction(const QString& actionText, const QString& libraryName = QString:
     return foundAction;
 }
 
-int main(int argc, char* argv[])
+/**
+* \brief Runs an operation of a plugin on a collection, in a thread of a pool
+*
+* If no plugin is given, the operation is run by a worker process dedicated to the thread.
+*/
+class OperationJob : public QRunnable
 {
-#ifdef HAVE_KEXIV2
-    KExiv2Iface::KExiv2::initializeExiv2();
-#endif
+public:
+
+    OperationJob(Plugin* const plugin, const QString& name, const ImageCollection& images,
+                 const QVariantMap& options, QVariantMap& results)
+        : m_plugin(plugin),
+          m_name(name),
+          m_images(images),
+          m_options(options),
+          m_results(results)
+    {
+    }
 
-    QApplication app(argc, argv);
-    app.setApplicationName(QLatin1String("kipicmd"));
-    app.setApplicationVersion(QLatin1String(KIPI_VERSION_STRING));
-    app.setOrganizationName(QLatin1String("http://www.kde.org"));
-    app.setWindowIcon(QIcon(QStandardPaths::locate(QStandardPaths::GenericDataLocation,
-                                                   QLatin1String(":/images/kipi-icon.svg"))));
+    void run() override
+    {
+        if (m_plugin)
+        {
+            m_results = m_plugin->runOperation(m_name, m_images, m_options);
+            return;
+        }
 
-    QCommandLineParser parser;
-    parser.addVersionOption();
-    parser.addHelpOption();
-    parser.setApplicationDescription(QLatin1String("kipi CLI host test application to run kipi tool as stand alone"));
+        // Workers are deleted, and their process stopped, when the pool threads exit.
+
+        if (!s_workers.hasLocalData())
+        {
+            s_workers.setLocalData(new PluginWorker);
+        }
+
+        m_results = s_workers.localData()->runOperation(m_name, m_images, m_options);
+    }
+
+private:
+
+    Plugin* const          m_plugin;
+    const QString          m_name;
+    const ImageCollection& m_images;
+    const QVariantMap&     m_options;
+    QVariantMap&           m_results;
+
+    static QThreadStorage<PluginWorker*> s_workers;
+};
+
+QThreadStorage<PluginWorker*> OperationJob::s_workers;
+
+/// Pool running the operations, created by the first operation. Deleted by main().
+static std::unique_ptr<QThreadPool> s_operationPool;
+
+/**
+* \brief Returns the pool running the operations, shared by all jobs
+*
+* Threads of the pool never expire, so that the worker process of each thread is reused by the next jobs.
+*/
+QThreadPool* OperationPool()
+{
+    if (!s_operationPool)
+    {
+        s_operationPool.reset(new QThreadPool);
+        s_operationPool->setExpiryTimeout(-1);
+    }
+
+    return s_operationPool.get();
+}
+
+/**
+* \brief Runs a headless operation of a plugin, without creating any widget
+* \param name Name of the operation to run
+* \param options List of "key=value" options passed to the operation
+* \param workers Number of worker processes to run the operation, or 0 to run it in this process
+* \param kipiInterface Interface used to get the collections to process
+* \returns False if the operation could not be found
+*
+* The operation is run once on the selected images, and once on each album, in parallel.
+* The results are printed on the standard output as JSON, one collection per line.
+*/
+bool RunOperation(const QString& name, const QStringList& options, int workers, KipiInterface* const kipiInterface)
+{
+    Plugin* plugin = nullptr;
+
+    if (workers == 0)
+    {
+        plugin = PluginLoader::instance()->operationPlugin(name);
+
+        if (!plugin)
+        {
+            qDebug() << QString::fromLatin1("Could not find operation \"%1\".").arg(name);
+            return false;
+        }
+    }
+
+    QVariantMap operationOptions;
+
+    for (const QString& option : options)
+    {
+        const int sep = option.indexOf(QLatin1Char('='));
+
+        if (sep == -1)
+            operationOptions.insert(option, true);
+        else
+            operationOptions.insert(option.left(sep), option.mid(sep + 1));
+    }
+
+    // Collections are built in the main thread and live until all jobs are done.
+
+    QList<ImageCollection> collections;
+    const ImageCollection  selection = kipiInterface->currentSelection();
+
+    if (!selection.images().isEmpty())
+        collections << selection;
 
+    collections << kipiInterface->allAlbums();
+
+    QVector<QVariantMap> results(collections.size());
+    QThreadPool* const pool = OperationPool();
+
+    pool->setMaxThreadCount(workers > 0 ? workers : QThread::idealThreadCount());
+
+    for (int i = 0; i < collections.size(); ++i)
+    {
+        pool->start(new OperationJob(plugin, name, collections.at(i), operationOptions, results[i]));
+    }
+
+    pool->waitForDone();
+
+    QTextStream out(stdout);
+
+    for (const QVariantMap& result : std::as_const(results))
+    {
+        out << QJsonDocument(QJsonObject::fromVariantMap(result)).toJson(QJsonDocument::Compact) << '\n';
+    }
+
+    return true;
+}
+
+/**
+* \brief Adds the options describing a job to a parser
+*/
+void AddJobOptions(QCommandLineParser& parser)
+{
     parser.addOption(QCommandLineOption(QStringList() << QLatin1String("list"),           QLatin1String("List the available plugins")));
     parser.addOption(QCommandLineOption(QStringList() << QLatin1String("w"),              QLatin1String("Wait until non-modal dialogs are closed")));
     parser.addOption(QCommandLineOption(QStringList() << QLatin1String("l"),              QLatin1String("Library name of plugin to use"),             QLatin1String("library")));
-    parser.addOption(QCommandLineOption(QStringList() << QLatin1String("a"),              QLatin1String("Action to call"),                            QLatin1String("action")));
+    parser.addOption(QCommandLineOption(QStringList() << QLatin1String("a"),              QLatin1String("Name or text of the action to call"),        QLatin1String("action")));
     parser.addOption(QCommandLineOption(QStringList() << QLatin1String("i"),              QLatin1String("Selected images"),                           QLatin1String("selectedimages")));
     parser.addOption(QCommandLineOption(QStringList() << QLatin1String("c"),              QLatin1String("Selected collections"),                       QLatin1String("selectedcollections")));
     parser.addOption(QCommandLineOption(QStringList() << QLatin1String("allc"),           QLatin1String("All collections"),                           QLatin1String("allcollections")));
+    parser.addOption(QCommandLineOption(QStringList() << QLatin1String("r"),              QLatin1String("Include images from sub-directories of collections")));
+    parser.addOption(QCommandLineOption(QStringList() << QLatin1String("op"),             QLatin1String("Headless operation to run, without display"), QLatin1String("operation")));
+    parser.addOption(QCommandLineOption(QStringList() << QLatin1String("opt"),            QLatin1String("Option of the operation, as key=value"),      QLatin1String("option")));
+    parser.addOption(QCommandLineOption(QStringList() << QLatin1String("workers"),        QLatin1String("Run the operation in this number of worker processes"), QLatin1String("count")));
     parser.addOption(QCommandLineOption(QStringList() << QLatin1String("+[images]"),      QLatin1String("List of images")));
     parser.addOption(QCommandLineOption(QStringList() << QLatin1String("+[collections]"), QLatin1String("List of collections")));
-    parser.process(app);
-
-    KipiInterface* const kipiInterface = new KipiInterface(&app);
-
-    PluginLoader* const loader = new PluginLoader(nullptr);
-    loader->setInterface(kipiInterface);
-    loader->init();
+}
 
+/**
+* \brief Reports the images and collections of a job to the interface
+* \returns False if filenames are given without telling how they should be used
+*/
+bool SetupJobImages(const QCommandLineParser& parser, KipiInterface* const kipiInterface)
+{
     QList<QUrl> listSelectedImages;
     QList<QUrl> listSelectedAlbums;
     QList<QUrl> listAllAlbums;
@@ -378,7 +600,7 @@ int main(int argc, char* argv[])
             {
                 qCritical() << "StartList is null.\n"
                                "Please specify how the filenames you provided should be used.";
-                return 0;
+                return false;
             }
             else
             {
@@ -391,20 +613,42 @@ int main(int argc, char* argv[])
     qDebug() << "listSelectedAlbums:" << listSelectedAlbums;
     qDebug() << "listAllAlbums:"      << listAllAlbums;
 
+    kipiInterface->clearImagesAndAlbums();
+    kipiInterface->setRecursiveAlbums(parser.isSet(QString::fromLatin1("r")));
     kipiInterface->addSelectedImages(listSelectedImages);
     kipiInterface->addSelectedAlbums(listSelectedAlbums);
     kipiInterface->addAlbums(listAllAlbums);
 
+    return true;
+}
+
+/**
+* \brief Runs the job described by the options of a parser
+* \param startedPlugin Set to true if a plugin action was called
+* \returns The exit code of the job
+*/
+int RunJob(const QCommandLineParser& parser, KipiInterface* const kipiInterface, bool* const startedPlugin)
+{
+    if (!SetupJobImages(parser, kipiInterface))
+        return 1;
+
     // determine whether only one plugin should be loaded
 
     const QString nameOfOnlyOnePluginToLoad = parser.value(QString::fromLatin1("l"));
 
     // determine what to do
 
-    int returnValue    = 0;
-    bool startedPlugin = false;
+    int returnValue = 0;
 
-    if ( parser.isSet(QString::fromLatin1("list")) )
+    if ( parser.isSet(QString::fromLatin1("op")) )
+    {
+        if ( !RunOperation( parser.value(QString::fromLatin1("op")), parser.values(QString::fromLatin1("opt")),
+                            parser.value(QString::fromLatin1("workers")).toInt(), kipiInterface ) )
+        {
+            returnValue = 1;
+        }
+    }
+    else if ( parser.isSet(QString::fromLatin1("list")) )
     {
         if (!ListPlugins( nameOfOnlyOnePluginToLoad ))
         {
@@ -423,7 +667,7 @@ int main(int argc, char* argv[])
         }
         else
         {
-            startedPlugin = true;
+            *startedPlugin = true;
         }
     }
     else
@@ -431,14 +675,287 @@ int main(int argc, char* argv[])
         qCritical() << "No argument specified: either use --list,\n"
                        "or specify an action to be called.\n"
                        "Example : ./kipicmd -w -lkipiplugin_kxmlhelloworld -a\"KXML Hello World Image...\" -i ~/Images/*";
-        return 0;
+        returnValue = 1;
+    }
+
+    return returnValue;
+}
+
+/**
+* \brief Processes events until all windows opened by a plugin action are closed
+*/
+void WaitForWindows()
+{
+    if (!qobject_cast<QApplication*>(QCoreApplication::instance()))
+        return;
+
+    // Let the action show its windows, if it deferred it.
+
+    QCoreApplication::processEvents();
+
+    for (;;)
+    {
+        bool visible = false;
+        const QWidgetList widgets = QApplication::topLevelWidgets();
+
+        for (QWidget* const widget : widgets)
+        {
+            if (widget->isVisible())
+            {
+                visible = true;
+                break;
+            }
+        }
+
+        if (!visible)
+            break;
+
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+}
+
+/**
+* \brief Runs the jobs listed in a script, one per line, with the same options than the command line
+* \param fileName Name of the script file, or "-" to read the standard input
+* \returns 0 if all jobs succeeded, 1 otherwise
+*
+* Plugins stay loaded between jobs. Empty lines and lines starting with '#' are ignored.
+* A job calling an action ends when the windows opened by the action are closed, so that its
+* duration includes the work done in them and the next job does not change the selection they use.
+* The result and the duration of each job are printed on the standard output.
+*/
+int RunScript(const QString& fileName, KipiInterface* const kipiInterface)
+{
+    QFile file;
+
+    if (fileName == QLatin1String("-"))
+    {
+        if (!file.open(stdin, QIODevice::ReadOnly | QIODevice::Text))
+        {
+            qCritical() << "Cannot read script from standard input:" << file.errorString();
+            return 1;
+        }
+    }
+    else
+    {
+        file.setFileName(fileName);
+
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            qCritical() << "Cannot open script" << fileName;
+            return 1;
+        }
+    }
+
+    QTextStream out(stdout);
+    QTextStream in(&file);
+    QElapsedTimer scriptTimer;
+    scriptTimer.start();
+
+    int jobs   = 0;
+    int failed = 0;
+
+    while (!in.atEnd())
+    {
+        const QString line = in.readLine().trimmed();
+
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
+            continue;
+
+        ++jobs;
+
+        QCommandLineParser jobParser;
+        AddJobOptions(jobParser);
+
+        QElapsedTimer timer;
+        timer.start();
+
+        int  ret           = 1;
+        bool startedPlugin = false;
+
+        if (!jobParser.parse(QStringList(QCoreApplication::applicationFilePath()) << QProcess::splitCommand(line)))
+        {
+            qCritical() << "Invalid job" << line << ":" << jobParser.errorText();
+        }
+        else
+        {
+            ret = RunJob(jobParser, kipiInterface, &startedPlugin);
+
+            if (startedPlugin)
+            {
+                WaitForWindows();
+            }
+        }
+
+        if (ret != 0)
+            ++failed;
+
+        out << "job " << jobs << ": " << (ret == 0 ? "done" : "failed") << " in "
+            << timer.elapsed() << " ms: " << line << '\n';
+        out.flush();
+    }
+
+    out << jobs << " jobs, " << failed << " failed, in " << scriptTimer.elapsed() << " ms\n";
+
+    return (failed == 0 ? 0 : 1);
+}
+
+/**
+* \brief Prints the spans and counters recorded by the library as one JSON line
+* \param elapsed Time elapsed since kipicmd started, in milliseconds
+*
+* Spans are summed by phase and plugin. Times are in milliseconds.
+*/
+void PrintStats(qint64 elapsed)
+{
+    struct Phase
+    {
+        int    count   = 0;
+        qint64 total   = 0;
+        qint64 longest = 0;
+    };
+
+    QMap<QPair<QString, QString>, Phase> phases;
+
+    for (const Profiler::Span& span : Profiler::spans())
+    {
+        Phase& phase = phases[qMakePair(span.phase, span.plugin)];
+        ++phase.count;
+        phase.total  += span.duration;
+        phase.longest = qMax(phase.longest, span.duration);
+    }
+
+    QJsonArray phaseList;
+
+    for (auto it = phases.constBegin() ; it != phases.constEnd() ; ++it)
+    {
+        QJsonObject phase;
+        phase.insert(QLatin1String("phase"),  it.key().first);
+        phase.insert(QLatin1String("plugin"), it.key().second);
+        phase.insert(QLatin1String("count"),  it.value().count);
+        phase.insert(QLatin1String("total"),  double(it.value().total)   / 1000.0);
+        phase.insert(QLatin1String("max"),    double(it.value().longest) / 1000.0);
+        phaseList.append(phase);
+    }
+
+    QJsonArray counterList;
+
+    for (const Profiler::Counter& counter : Profiler::counters())
+    {
+        QJsonObject object;
+        object.insert(QLatin1String("name"),   counter.name);
+        object.insert(QLatin1String("plugin"), counter.plugin);
+        object.insert(QLatin1String("value"),  double(counter.value));
+        counterList.append(object);
     }
 
-    int ret = returnValue;
+    QJsonObject stats;
+    stats.insert(QLatin1String("elapsed"),  double(elapsed));
+    stats.insert(QLatin1String("phases"),   phaseList);
+    stats.insert(QLatin1String("counters"), counterList);
+
+    QJsonObject report;
+    report.insert(QLatin1String("stats"), stats);
+
+    QTextStream(stdout) << QJsonDocument(report).toJson(QJsonDocument::Compact) << '\n';
+}
+
+int main(int argc, char* argv[])
+{
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+#ifdef HAVE_KEXIV2
+    KExiv2Iface::KExiv2::initializeExiv2();
+#endif
+
+    // Headless operations and plugin workers do not need a display: look for them before the application is created.
+
+    bool headless = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const QByteArray arg(argv[i]);
+
+        if (arg == "--op" || arg.startsWith("--op=") || arg == "--kipi-worker")
+        {
+            headless = true;
+            break;
+        }
+    }
+
+    std::unique_ptr<QCoreApplication> app(headless ? new QCoreApplication(argc, argv)
+                                                   : new QApplication(argc, argv));
+    app->setApplicationName(QLatin1String("kipicmd"));
+    app->setApplicationVersion(QLatin1String(KIPI_VERSION_STRING));
+    app->setOrganizationName(QLatin1String("http://www.kde.org"));
+
+    if (!headless)
+    {
+        QApplication::setWindowIcon(QIcon(QStandardPaths::locate(QStandardPaths::GenericDataLocation,
+                                                                 QLatin1String(":/images/kipi-icon.svg"))));
+    }
+
+    if (PluginWorker::isWorkerProcess(app->arguments()))
+    {
+        KipiInterface* const workerInterface = new KipiInterface(app.get());
+
+        PluginLoader* const workerLoader = new PluginLoader(nullptr);
+        workerLoader->setInterface(workerInterface);
+        workerLoader->init();
+
+        return PluginWorker::exec(workerLoader);
+    }
+
+    QCommandLineParser parser;
+    parser.addVersionOption();
+    parser.addHelpOption();
+    parser.setApplicationDescription(QLatin1String("kipi CLI host test application to run kipi tool as stand alone"));
+    AddJobOptions(parser);
+    parser.addOption(QCommandLineOption(QStringList() << QLatin1String("script"),         QLatin1String("Run the jobs listed in a file, or in standard input with \"-\""), QLatin1String("file")));
+    parser.addOption(QCommandLineOption(QStringList() << QLatin1String("stats"),          QLatin1String("Print the time spent in each phase and the data processed, as JSON")));
+    parser.process(*app);
+
+    const bool stats = parser.isSet(QString::fromLatin1("stats"));
+
+    if (stats)
+    {
+        Profiler::setEnabled(true);
+    }
+
+    KipiInterface* const kipiInterface = new KipiInterface(app.get());
+
+    PluginLoader* const loader = new PluginLoader(nullptr);
+    loader->setInterface(kipiInterface);
+    loader->init();
+
+    int ret = 0;
+
+    if ( parser.isSet(QString::fromLatin1("script")) )
+    {
+        // Each job already waited for the windows it opened.
+
+        ret = RunScript( parser.value(QString::fromLatin1("script")), kipiInterface );
+    }
+    else
+    {
+        bool startedPlugin = false;
+        ret                = RunJob( parser, kipiInterface, &startedPlugin );
+
+        if (startedPlugin && parser.isSet(QString::fromLatin1("w")))
+        {
+            ret = app->exec();
+        }
+    }
+
+    // Threads of the pool delete their worker when they exit, which stops the worker processes.
+
+    s_operationPool.reset();
+    s_hostWidget.reset();
 
-    if (startedPlugin && parser.isSet(QString::fromLatin1("w")))
+    if (stats)
     {
-        ret = app.exec();
+        PrintStats(elapsed.elapsed());
     }
 
 #ifdef HAVE_KEXIV2
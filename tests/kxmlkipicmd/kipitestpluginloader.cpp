@@ -19,6 +19,10 @@
 #include <KXMLGUIFactory>
 #include <KXmlGuiWindow>
 
+// Libkipi includes
+
+#include "profiler.h"
+
 // Local includes
 
 #include "kipiinterface.h"
@@ -38,6 +42,7 @@ public:
         kipipluginsActionCollection = nullptr;
         kipiPluginLoader            = nullptr;
         kipiInterface               = nullptr;
+        replugging                  = false;
     }
 
     PluginLoader*               kipiPluginLoader;
@@ -46,6 +51,9 @@ public:
 
     KActionCollection*          kipipluginsActionCollection;
     QMap<int, KActionCategory*> kipiCategoryMap;
+
+    /// True while all plugins are plugged by slotKipiPluginsPlug().
+    bool                        replugging;
 };
 
 // -- Static values -------------------------------
@@ -124,27 +132,39 @@ void KipiTestPluginLoader::loadPlugins()
     d->kipiPluginLoader = new PluginLoader(d->app);
     d->kipiPluginLoader->setInterface(d->kipiInterface);
     d->kipiPluginLoader->setIgnoredPluginsList(ignores);
+    d->kipiPluginLoader->setPreloadPluginsEnabled(true);
+    d->kipiPluginLoader->setIncrementalReplugEnabled(true);
     d->kipiPluginLoader->init();
 
     connect(d->kipiPluginLoader, &PluginLoader::replug,
             this, &KipiTestPluginLoader::slotKipiPluginsPlug);
 
+    connect(d->kipiPluginLoader, &PluginLoader::plug,
+            this, &KipiTestPluginLoader::slotKipiPluginPlug);
+
+    connect(d->kipiPluginLoader, &PluginLoader::unplug,
+            this, &KipiTestPluginLoader::slotKipiPluginUnplug);
+
     d->kipiPluginLoader->loadPlugins();
 }
 
 void KipiTestPluginLoader::slotKipiPluginsPlug()
 {
+    // Plugins created below emit plug(): they are set up here.
+    d->replugging = true;
+
     d->kipiCategoryMap.clear();
     d->kipipluginsActionCollection->clear();
 
+    d->kipiPluginLoader->unplugAll();
+
     PluginLoader::PluginList list = d->kipiPluginLoader->pluginList();
-    int cpt                       = 0;
 
     for (PluginLoader::PluginList::ConstIterator it = list.constBegin() ; it != list.constEnd() ; ++it)
     {
         Plugin* const plugin = (*it)->plugin();
 
-        if (!plugin || !(*it)->shouldLoad())
+        if (!plugin || !(*it)->shouldLoad() || !plugin->factory())
         {
             continue;
         }
@@ -152,8 +172,6 @@ void KipiTestPluginLoader::slotKipiPluginsPlug()
         d->app->guiFactory()->removeClient(plugin);
     }
 
-    QStringList disabledActions = d->kipiPluginLoader->disabledPluginActions();
-
     for (PluginLoader::PluginList::ConstIterator it = list.constBegin() ; it != list.constEnd() ; ++it)
     {
         Plugin* const plugin = (*it)->plugin();
@@ -163,55 +181,105 @@ void KipiTestPluginLoader::slotKipiPluginsPlug()
             continue;
         }
 
-        ++cpt;
-        plugin->setup(d->app);
-        plugin->rebuild();
+        setupPlugin(*it, plugin);
+    }
 
-        const auto pluginActions = plugin->actions();
-        for (QAction* const action : pluginActions)
-        {
-            QString actionName(action->objectName());
-            Category cat = plugin->category(action);
+    // All plugins are added with a single call, so that the gui factory emits makingChanges() one time.
+    d->kipiPluginLoader->plugAll(d->app->guiFactory());
 
-            if (cat == InvalidCategory)
-            {
-                qWarning() << "Plugin action '" << actionName << "' has invalid category!";
-                continue;
-            }
+    // load KIPI actions settings
+    d->kipipluginsActionCollection->readSettings();
 
-            if (!disabledActions.contains(actionName))
-            {
-                KActionCategory* category = d->kipiCategoryMap[cat];
+    d->replugging = false;
+}
 
-                if (!category)
-                {
-                    category = new KActionCategory(categoryName(cat), d->kipipluginsActionCollection);
-                    d->kipiCategoryMap.insert(cat, category);
-                }
+void KipiTestPluginLoader::slotKipiPluginPlug(KIPI::PluginLoader::Info* info)
+{
+    if (d->replugging || !info->shouldLoad())
+    {
+        return;
+    }
 
-                category->addAction(actionName, qobject_cast<QAction*>(action));
-            }
-            else
-            {
-                qDebug() << "Plugin '" << actionName << "' is disabled.";
-            }
-        }
+    Plugin* const plugin = info->plugin();
+
+    if (!plugin)
+    {
+        return;
     }
 
-    for (PluginLoader::PluginList::ConstIterator it = list.constBegin() ; it != list.constEnd() ; ++it)
+    qDebug() << "Plug" << info->uname();
+
+    setupPlugin(info, plugin);
+
     {
-        Plugin* const plugin = (*it)->plugin();
+        Profiler::Scope scope("KXMLGUIFactory::addClient", info->uname());
+        d->app->guiFactory()->addClient(plugin);
+    }
 
-        if (!plugin || !(*it)->shouldLoad())
+    d->kipipluginsActionCollection->readSettings();
+}
+
+void KipiTestPluginLoader::slotKipiPluginUnplug(KIPI::PluginLoader::Info* info)
+{
+    // Plugin is still loaded when this signal is emitted.
+    Plugin* const plugin = info->plugin();
+
+    if (!plugin)
+    {
+        return;
+    }
+
+    qDebug() << "Unplug" << info->uname();
+
+    const auto pluginActions = plugin->actions();
+
+    for (QAction* const action : pluginActions)
+    {
+        // The action is owned by the plugin, which will delete it.
+        d->kipipluginsActionCollection->takeAction(action);
+    }
+
+    d->app->guiFactory()->removeClient(plugin);
+}
+
+void KipiTestPluginLoader::setupPlugin(PluginLoader::Info* const info, Plugin* const plugin)
+{
+    {
+        Profiler::Scope scope("Plugin::setup", info->uname());
+        plugin->setup(d->app);
+        plugin->rebuild();
+    }
+
+    const auto pluginActions = plugin->actions();
+
+    for (QAction* const action : pluginActions)
+    {
+        QString actionName(action->objectName());
+        Category cat = plugin->category(action);
+
+        if (cat == InvalidCategory)
         {
+            qWarning() << "Plugin action '" << actionName << "' has invalid category!";
             continue;
         }
 
-        d->app->guiFactory()->addClient(plugin);
-    }
+        if (!d->kipiPluginLoader->isActionDisabled(actionName))
+        {
+            KActionCategory* category = d->kipiCategoryMap[cat];
 
-    // load KIPI actions settings
-    d->kipipluginsActionCollection->readSettings();
+            if (!category)
+            {
+                category = new KActionCategory(categoryName(cat), d->kipipluginsActionCollection);
+                d->kipiCategoryMap.insert(cat, category);
+            }
+
+            category->addAction(actionName, qobject_cast<QAction*>(action));
+        }
+        else
+        {
+            qDebug() << "Plugin '" << actionName << "' is disabled.";
+        }
+    }
 }
 
 void KipiTestPluginLoader::checkEmptyCategory(Category cat)
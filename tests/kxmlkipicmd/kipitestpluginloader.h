@@ -52,11 +52,17 @@ private Q_SLOTS:
      */
     void slotKipiPluginsPlug();
 
+    /** Called by PluginLoader when one plugin is loaded or unloaded
+     */
+    void slotKipiPluginPlug(KIPI::PluginLoader::Info* info);
+    void slotKipiPluginUnplug(KIPI::PluginLoader::Info* info);
+
 private:
 
     ~KipiTestPluginLoader() override;
 
     void loadPlugins();
+    void setupPlugin(PluginLoader::Info* const info, Plugin* const plugin);
     void checkEmptyCategory(Category cat);
     QString categoryName(Category cat) const;
     QString categoryShortName(Category cat) const;
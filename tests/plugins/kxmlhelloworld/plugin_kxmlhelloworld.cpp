@@ -118,6 +118,31 @@ Plugin_KXMLHelloWorld::Plugin_KXMLHelloWorld(QObject* const parent, const QVaria
       * be merged with those of the KIPI host app
       */
     setupXML();
+
+    /** Headless operations are registered in constructor, as they must be available without setup().
+     *  They can be run by host application with KIPI::Plugin::runOperation(), even without a display.
+     *  This one returns the file names of the collection items, optionally filtered by a suffix.
+     */
+    addOperation(QString::fromLatin1("kxmlhelloworld-list"),
+                 [](const ImageCollection& images, const QVariantMap& options)
+                 {
+                     const QString suffix = options.value(QString::fromLatin1("suffix")).toString();
+                     QStringList names;
+
+                     const auto imageUrls = images.images();
+                     for (const QUrl& url : imageUrls)
+                     {
+                         if (suffix.isEmpty() || url.fileName().endsWith(suffix, Qt::CaseInsensitive))
+                             names << url.fileName();
+                     }
+
+                     QVariantMap results;
+                     results.insert(QString::fromLatin1("collection"), images.name());
+                     results.insert(QString::fromLatin1("names"),      names);
+                     results.insert(QString::fromLatin1("count"),      names.count());
+
+                     return results;
+                 });
 }
 
 Plugin_KXMLHelloWorld::~Plugin_KXMLHelloWorld()